@@ -0,0 +1,206 @@
+#include <cmath>
+#include <vector>
+
+#include "TDD/DD.cpp"
+#include "TDD/DDBuilder.cpp"
+
+#ifndef DD_EXAMPLES_H // include guard
+#define DD_EXAMPLES_H
+//  --------------------------- Example diagrams --------------------------- 
+
+DD* createControlatedDD() {
+    DDBuilder builder;
+
+    IEdge*  leftNode1 = builder.leaf(1);
+    IEdge* rightNode1 = builder.leaf(2);
+    IEdge*  leftNode2 = builder.leaf(1);
+    IEdge* rightNode2 = builder.leaf(3);
+    IEdge*  leftNode3 = builder.leaf(1);
+    IEdge* rightNode3 = builder.leaf(4);
+    IEdge*  leftNode4 = builder.leaf(1);
+    IEdge* rightNode4 = builder.leaf(5);
+    IEdge*  leftNode5 = builder.leaf(1);
+    IEdge* rightNode5 = builder.leaf(6);
+    IEdge*  leftNode6 = builder.leaf(1);
+    IEdge* rightNode6 = builder.leaf(7);
+    IEdge*  leftNode7 = builder.leaf(1);
+    IEdge* rightNode7 = builder.leaf(2);
+    IEdge*  leftNode8 = builder.leaf(1);
+    IEdge* rightNode8 = builder.leaf(3);
+
+    IEdge*  leftNode1_1 = builder.node(1, leftNode1, rightNode1);
+    IEdge* rightNode1_1 = builder.node(2, leftNode2, rightNode2);
+    IEdge*  leftNode2_1 = builder.node(1, leftNode3, rightNode3);
+    IEdge* rightNode2_1 = builder.node(2, leftNode4, rightNode4);
+    IEdge*  leftNode3_1 = builder.node(1, leftNode5, rightNode5);
+    IEdge* rightNode3_1 = builder.node(2, leftNode6, rightNode6);
+    IEdge*  leftNode4_1 = builder.node(1, leftNode7, rightNode7);
+    IEdge* rightNode4_1 = builder.node(2, leftNode8, rightNode8);
+    
+    IEdge*  leftNode1_2 = builder.node(2, leftNode1_1, rightNode1_1);
+    IEdge* rightNode1_2 = builder.node(10, leftNode2_1, rightNode2_1);
+    IEdge*  leftNode2_2 = builder.node(5, leftNode3_1, rightNode3_1);
+    IEdge* rightNode2_2 = builder.node(2, leftNode4_1, rightNode4_1);
+
+    IEdge*  leftNode1_3 = builder.node(2, leftNode1_2, rightNode1_2);
+    IEdge* rightNode1_3 = builder.node(3, leftNode2_2, rightNode2_2);
+
+    IEdge* head = builder.node(10, leftNode1_3, rightNode1_3);
+
+    return builder.build(head);  // Expected result: 580 608 000
+}
+
+DD* createSmallDD() {
+    DDBuilder builder;
+
+    IEdge*  leftNode1 = builder.leaf(1);
+    IEdge* rightNode1 = builder.leaf(2);
+    IEdge*  leftNode2 = builder.leaf(3);
+    IEdge* rightNode2 = builder.leaf(4);
+    IEdge*  leftNode3 = builder.leaf(5);
+    IEdge* rightNode3 = builder.leaf(6);
+    IEdge*  leftNode4 = builder.leaf(7);
+    IEdge* rightNode4 = builder.leaf(8);
+    IEdge*  leftNode5 = builder.leaf(9);
+    IEdge* rightNode5 = builder.leaf(10);
+    IEdge*  leftNode6 = builder.leaf(11);
+    IEdge* rightNode6 = builder.leaf(12);
+    IEdge*  leftNode7 = builder.leaf(13);
+    IEdge* rightNode7 = builder.leaf(14);
+    IEdge*  leftNode8 = builder.leaf(15);
+    IEdge* rightNode8 = builder.leaf(16);
+
+    IEdge*  leftNode1_1 = builder.node(17, leftNode1, rightNode1);
+    IEdge* rightNode1_1 = builder.node(18, leftNode2, rightNode2);
+    IEdge*  leftNode2_1 = builder.node(19, leftNode3, rightNode3);
+    IEdge* rightNode2_1 = builder.node(20, leftNode4, rightNode4);
+    IEdge*  leftNode3_1 = builder.node(21, leftNode5, rightNode5);
+    IEdge* rightNode3_1 = builder.node(22, leftNode6, rightNode6);
+    IEdge*  leftNode4_1 = builder.node(23, leftNode7, rightNode7);
+    IEdge* rightNode4_1 = builder.node(24, leftNode8, rightNode8);
+    
+    IEdge*  leftNode1_2 = builder.node(25, leftNode1_1, rightNode1_1);
+    IEdge* rightNode1_2 = builder.node(26, leftNode2_1, rightNode2_1);
+    IEdge*  leftNode2_2 = builder.node(27, leftNode3_1, rightNode3_1);
+    IEdge* rightNode2_2 = builder.node(28, leftNode4_1, rightNode4_1);
+
+    IEdge*  leftNode1_3 = builder.node(29, leftNode1_2, rightNode1_2);
+    IEdge* rightNode1_3 = builder.node(30, leftNode2_2, rightNode2_2);
+
+    IEdge* head = builder.node(31, leftNode1_3, rightNode1_3);
+
+    return builder.build(builder.node(32, head, head));
+}
+
+DD* createLargeDD() {
+    DDBuilder builder;
+
+    // 2^15 leaves below 15 levels
+    int maxLevel = 16;
+    std::vector<IEdge*> previous;
+    std::vector<IEdge*> nodeArray = builder.leaves(pow(2, maxLevel - 1), [](std::size_t i) {
+        return ComplexNumber(i+1, 1);
+    });
+
+    for (int level = 1; level < maxLevel; level++) {
+        previous = nodeArray;
+        nodeArray = builder.pairs(nodeArray, [level](std::size_t i) {
+            return ComplexNumber(level + 1, i);
+        });
+    }
+    // The top levels also use the second node of the level below the root
+    nodeArray.push_back(previous[1]);
+
+    IEdge*  leftNode1 = builder.node(2, nodeArray[0], nodeArray[0]);
+    IEdge* rightNode1 = builder.node(3, nodeArray[0], nodeArray[0]);
+    IEdge*  leftNode2 = builder.node(2, nodeArray[0], nodeArray[0]);
+    IEdge* rightNode2 = builder.node(5, nodeArray[1], nodeArray[1]);
+    IEdge*  leftNode3 = builder.node(6, nodeArray[1], nodeArray[0]);
+    IEdge* rightNode3 = builder.node(7, nodeArray[0], nodeArray[1]);
+    IEdge*  leftNode4 = builder.node(8, nodeArray[0], nodeArray[1]);
+    IEdge* rightNode4 = builder.node(9, nodeArray[1], nodeArray[0]);
+
+    leftNode1  = builder.node(3, leftNode1, rightNode1);
+    rightNode1 = builder.node(4, leftNode2, rightNode2);
+    leftNode2  = builder.node(5, leftNode3, rightNode3);
+    rightNode2 = builder.node(6, leftNode4, rightNode4);
+
+    IEdge* leftNode = builder.node(10, leftNode1, rightNode1);
+    IEdge* rightNode = builder.node(10, leftNode2, rightNode2);
+
+    return builder.build(builder.node(7, leftNode, rightNode));
+}
+
+// 64 copies of a 2^10 leaves subdiagram below a 6 level tree. In copy j the left leaf of each
+// pair has its weight multiplied by a divisor d of 3 * 7 * 11 * 13 * 19 * 23, a different one
+// in every copy, and the right leaf by the product over d. The value of an edge multiplies
+// both child weights, so the copies have the same products, see DD::setNormalized.
+DD* createScaledDD() {
+    DDBuilder builder;
+
+    int copyLevel = 10;
+    int numCopies = 64;
+    const long primes[] = {3, 7, 11, 13, 19, 23};
+    std::vector<IEdge*> copyArray(numCopies);
+
+    for(int copy = 0; copy < numCopies; copy++) {
+        long left = 1;
+        long right = 1;
+        for (int bit = 0; bit < 6; bit++)
+            (copy >> bit & 1 ? left : right) *= primes[bit];
+        std::vector<IEdge*> nodeArray = builder.leaves(pow(2, copyLevel), [left, right](std::size_t i) {
+            return ComplexNumber(i + 1, 1).product(ComplexNumber(i % 2 == 0 ? left : right));
+        });
+        for (int level = 1; level <= copyLevel; level++) {
+            nodeArray = builder.pairs(nodeArray, [level](std::size_t i) {
+                return ComplexNumber(level + 1, i);
+            });
+        }
+        copyArray[copy] = nodeArray[0];
+    }
+
+    while (copyArray.size() > 1) {
+        copyArray = builder.pairs(copyArray, [](std::size_t i) {
+            return ComplexNumber(i + 2);
+        });
+    }
+
+    return builder.build(copyArray[0]);
+}
+
+// Every leaf and every node of a level carries the same weight, so the 2^18 leaves tree
+// reduces to one node per level
+DD* createEqualDD() {
+    DDBuilder builder;
+
+    // 2^18 leaves below 18 levels
+    int maxLevel = 19;
+    std::vector<IEdge*> nodeArray = builder.leaves(pow(2, maxLevel - 1), [](std::size_t) {
+        return ComplexNumber(100);
+    });
+
+    for (int level = 1; level < maxLevel; level++) {
+        nodeArray = builder.pairs(nodeArray, [level](std::size_t) {
+            return ComplexNumber((level + 1) * 100);
+        });
+    }
+    IEdge* leftNode = builder.node(10, nodeArray[0], nodeArray[0]);
+    IEdge* rightNode = builder.node(5, nodeArray[0], nodeArray[0]);
+
+    return builder.build(builder.node(7, leftNode, rightNode));
+}
+
+// A chain of 2^18 nodes, each with the rest of the chain on the left and a leaf on the right.
+// Far too deep for the recursive evaluators, see DD::getDDProductIterative.
+DD* createChainDD() {
+    DDBuilder builder;
+
+    int depth = pow(2, 18);
+    IEdge* chain = builder.leaf(3);
+    for(int i = 1; i <= depth; i++) {
+        chain = builder.node(ComplexNumber(i % 7 + 2, i % 3), chain, builder.leaf(i % 5 + 1));
+    }
+
+    return builder.build(chain);
+}
+#endif
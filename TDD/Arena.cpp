@@ -0,0 +1,180 @@
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#ifndef ARENA_H // include guard
+#define ARENA_H
+// Region allocator owned by a DD. Every thread bumps through its own region, so objects built
+// together by one thread sit next to each other and allocation never contends on malloc.
+// Memory is handed back all at once when the arena is destroyed, blocks deleted before that
+// go to a per-thread free list of their size and are reused by later allocations.
+//
+// Each block is prefixed by a header naming its owning arena (or nullptr for heap blocks), so
+// the class operators new/delete of Node and Edge can tell both kinds apart.
+class Arena {
+    // Constructors
+    public:
+        Arena(std::size_t regionSize = DEFAULT_REGION_SIZE) {
+            static std::atomic<uint64_t> counter(1);
+            this->id = counter.fetch_add(1, std::memory_order_relaxed);
+            this->regionSize = regionSize;
+            this->allocatedBytes = 0;
+        }
+
+        ~Arena() {
+            for (char* chunk : chunks)
+                ::operator delete(chunk);
+        }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+    // Methods
+    public:
+        void* allocate(std::size_t size) {
+            size = roundUp(size + HEADER_SIZE);
+            Region* region = getRegion();
+            allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+            std::size_t sizeClass = size / ALIGNMENT;
+            if (sizeClass < NUM_SIZE_CLASSES && region->freeLists[sizeClass] != nullptr) {
+                char* block = region->freeLists[sizeClass];
+                region->freeLists[sizeClass] = *reinterpret_cast<char**>(block + HEADER_SIZE);
+                return block + HEADER_SIZE;
+            }
+            if (region->cursor + size > region->end)
+                refill(region, size);
+            char* block = region->cursor;
+            region->cursor += size;
+            *reinterpret_cast<Arena**>(block) = this;
+            return block + HEADER_SIZE;
+        }
+
+        // Hands a block back to the free list of the calling thread
+        void release(void* p, std::size_t size) {
+            size = roundUp(size + HEADER_SIZE);
+            allocatedBytes.fetch_sub(size, std::memory_order_relaxed);
+            std::size_t sizeClass = size / ALIGNMENT;
+            if (sizeClass >= NUM_SIZE_CLASSES)
+                return;
+            Region* region = getRegion();
+            char* block = static_cast<char*>(p) - HEADER_SIZE;
+            *reinterpret_cast<char**>(p) = region->freeLists[sizeClass];
+            region->freeLists[sizeClass] = block;
+        }
+
+        // Bytes of the blocks currently handed out
+        std::size_t getAllocatedBytes() {
+            return allocatedBytes.load(std::memory_order_relaxed);
+        }
+
+    // Static methods
+    public:
+        // Allocates from the calling thread's current arena, or from the heap when there is none
+        static void* allocateCurrent(std::size_t size) {
+            Arena* arena = current();
+            if (arena != nullptr)
+                return arena->allocate(size);
+            char* block = static_cast<char*>(::operator new(size + HEADER_SIZE));
+            *reinterpret_cast<Arena**>(block) = nullptr;
+            return block + HEADER_SIZE;
+        }
+
+        static void deallocate(void* p, std::size_t size) {
+            if (p == nullptr)
+                return;
+            char* block = static_cast<char*>(p) - HEADER_SIZE;
+            Arena* owner = *reinterpret_cast<Arena**>(block);
+            if (owner == nullptr)
+                ::operator delete(block);
+            else
+                owner->release(p, size);
+        }
+
+        static Arena*& current() {
+            static thread_local Arena* arena = nullptr;
+            return arena;
+        }
+
+        // Makes an arena the current one of the calling thread for the lifetime of the scope
+        class Scope {
+            public:
+                Scope(Arena* arena) {
+                    previous = current();
+                    current() = arena;
+                }
+
+                ~Scope() {
+                    current() = previous;
+                }
+
+            private:
+                Arena* previous;
+        };
+
+    private:
+        static const std::size_t NUM_SIZE_CLASSES = 64;
+
+    // Private methods
+    private:
+        struct Region {
+            char* cursor = nullptr;
+            char* end = nullptr;
+            char* freeLists[NUM_SIZE_CLASSES] = {};
+        };
+
+        struct CachedRegion {
+            uint64_t arenaId = 0;
+            Region* region = nullptr;
+        };
+
+        static std::size_t roundUp(std::size_t size) {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        // The last region used by this thread is cached, the registry is only consulted on a change of arena
+        Region* getRegion() {
+            static thread_local CachedRegion cached;
+            if (cached.arenaId == id)
+                return cached.region;
+            std::lock_guard<std::mutex> guard(lock);
+            Region*& region = regions[std::this_thread::get_id()];
+            if (region == nullptr) {
+                regionStore.emplace_back();
+                region = &regionStore.back();
+            }
+            cached.arenaId = id;
+            cached.region = region;
+            return region;
+        }
+
+        void refill(Region* region, std::size_t size) {
+            std::size_t chunkSize = size > regionSize ? size : regionSize;
+            char* chunk = static_cast<char*>(::operator new(chunkSize));
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                chunks.push_back(chunk);
+            }
+            region->cursor = chunk;
+            region->end = chunk + chunkSize;
+        }
+
+    private:
+        static const std::size_t ALIGNMENT = alignof(uint64_t);
+        static const std::size_t HEADER_SIZE = sizeof(Arena*);
+        static const std::size_t DEFAULT_REGION_SIZE = 1 << 20;
+
+        uint64_t id;
+        std::size_t regionSize;
+        std::atomic<std::size_t> allocatedBytes;
+        std::mutex lock;
+        std::vector<char*> chunks;
+        std::unordered_map<std::thread::id, Region*> regions;
+        std::deque<Region> regionStore;
+};
+#endif
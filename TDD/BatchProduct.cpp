@@ -0,0 +1,106 @@
+#include <cstddef>
+#include <type_traits>
+
+#include "ComplexNumber.cpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define TDD_BATCH_AVX2
+#endif
+
+#ifndef BATCH_PRODUCT_H // include guard
+#define BATCH_PRODUCT_H
+// Element-wise modular complex products over contiguous arrays of weights. The AVX2 path
+// multiplies two weights per vector and is picked at run time, so the build needs no -mavx2.
+// Results are bit-identical to ComplexNumber::product, sign of the residues included.
+class BatchProduct {
+    static_assert(ComplexNumber::getModulus() < (1L << 30), "Residues must fit the signed 32 bit multiplier lanes");
+    static_assert(sizeof(ComplexNumber) == 2 * sizeof(long) && std::is_standard_layout<ComplexNumber>::value,
+                  "The vector path loads weights as (real, imaginary) pairs of longs");
+
+    // Methods
+    public:
+        // out[i] = a[i] * b[i], out may be a or b
+        static void multiply(const ComplexNumber* a, const ComplexNumber* b, ComplexNumber* out, size_t n) {
+#ifdef TDD_BATCH_AVX2
+            if (isVectorized()) {
+                multiplyAVX2(a, b, out, n);
+                return;
+            }
+#endif
+            multiplyScalar(a, b, out, n);
+        }
+
+        static void multiplyScalar(const ComplexNumber* a, const ComplexNumber* b, ComplexNumber* out, size_t n) {
+            for(size_t i = 0; i < n; i++)
+                out[i] = a[i].product(b[i]);
+        }
+
+        // Product of all the values, multiplied pairwise in halves. Overwrites the array.
+        static ComplexNumber reduce(ComplexNumber* values, size_t n) {
+            if (n == 0)
+                return ComplexNumber();
+            while (n > 1) {
+                size_t half = (n + 1) / 2;
+                multiply(values, values + half, values, n - half);
+                n = half;
+            }
+            return values[0];
+        }
+
+        static bool isVectorized() {
+#ifdef TDD_BATCH_AVX2
+            static const bool supported = __builtin_cpu_supports("avx2");
+            return supported;
+#else
+            return false;
+#endif
+        }
+
+#ifdef TDD_BATCH_AVX2
+    private:
+        __attribute__((target("avx2")))
+        static void multiplyAVX2(const ComplexNumber* a, const ComplexNumber* b, ComplexNumber* out, size_t n) {
+            const __m256i modulus = _mm256_set1_epi64x(ComplexNumber::getModulus());
+            const __m256d inverse = _mm256_set1_pd(1048576.0 / ComplexNumber::getModulus()); // 2^20 / MOD
+            size_t i = 0;
+            for(; i + 2 <= n; i += 2) {
+                __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+                __m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+                __m256i ySwapped = _mm256_shuffle_epi32(y, _MM_SHUFFLE(1, 0, 3, 2));
+                // Lanes hold (real, imaginary) pairs and residues are below 2^30, so the
+                // signed 32x32->64 bit multiply is exact
+                __m256i direct = _mm256_mul_epi32(x, y);
+                __m256i crossed = _mm256_mul_epi32(x, ySwapped);
+                __m256i low = _mm256_unpacklo_epi64(direct, crossed);
+                __m256i high = _mm256_unpackhi_epi64(direct, crossed);
+                // Real parts subtract in the even lanes, imaginary parts add in the odd ones
+                __m256i products = _mm256_blend_epi32(_mm256_add_epi64(low, high), _mm256_sub_epi64(low, high), 0x33);
+                _mm256_storeu_si256((__m256i*) (out + i), reduceAVX2(products, modulus, inverse));
+            }
+            for(; i < n; i++)
+                out[i] = a[i].product(b[i]);
+        }
+
+        // x % MOD for |x| < 2^61, truncated towards zero like the scalar %
+        __attribute__((target("avx2")))
+        static __m256i reduceAVX2(__m256i x, __m256i modulus, __m256d inverse) {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256d magic = _mm256_set1_pd(4503599627370496.0); // 2^52
+            __m256i sign = _mm256_cmpgt_epi64(zero, x);
+            __m256i magnitude = _mm256_sub_epi64(_mm256_xor_si256(x, sign), sign);
+            // magnitude >> 20 is below 2^41 and converts exactly through the 2^52 exponent trick.
+            // The dropped bits and the rounding move the quotient by far less than the 0.5
+            // taken off, so q is floor(magnitude / MOD) or one less and r ends in [0, 2 * MOD).
+            __m256i shifted = _mm256_or_si256(_mm256_srli_epi64(magnitude, 20), _mm256_castpd_si256(magic));
+            __m256d value = _mm256_sub_pd(_mm256_castsi256_pd(shifted), magic);
+            __m256d quotient = _mm256_sub_pd(_mm256_mul_pd(value, inverse), _mm256_set1_pd(0.5));
+            __m256i q = _mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(quotient));
+            __m256i r = _mm256_sub_epi64(magnitude, _mm256_mul_epu32(q, modulus));
+            __m256i overflow = _mm256_cmpgt_epi64(r, _mm256_sub_epi64(modulus, _mm256_set1_epi64x(1)));
+            r = _mm256_sub_epi64(r, _mm256_and_si256(overflow, modulus));
+            return _mm256_sub_epi64(_mm256_xor_si256(r, sign), sign);
+        }
+#endif
+};
+#endif
@@ -1,10 +1,15 @@
+#include <string>
+#include <type_traits>
+
 using namespace std;
 
-#include "Interfaces.cpp"
+#include "ModArith.cpp"
 
 #ifndef COMPLEX_NUMBER_H // include guard
 #define COMPLEX_NUMBER_H
-class ComplexNumber : public IComplexNumber {
+// Modular complex weight. A plain value type: no vtable, trivially copyable and multiplied
+// in registers, so weights are stored inline in edges and never allocated on the heap.
+class ComplexNumber {
     // Constructors
     public:
         ComplexNumber() {
@@ -26,32 +31,63 @@ class ComplexNumber : public IComplexNumber {
 
     // Methods
     public:
-        long getRealPart() {
+        long getRealPart() const {
             return this->real;
         }
 
-        long getImaginaryPart() {
+        long getImaginaryPart() const {
             return this->imaginary;
         }
 
-        string get_string() {
+        string get_string() const {
             return std::to_string(this->real) + "+" + std::to_string(this->imaginary) + "i";
         }
 
         void normalize() {
             //cout << this->get_string() << "\n";
-            this->real = this->real % MOD_NUMBER;
-            this->imaginary = this->imaginary % MOD_NUMBER;
+            this->real = ModularReducer<MOD_NUMBER>::reduce(this->real);
+            this->imaginary = ModularReducer<MOD_NUMBER>::reduce(this->imaginary);
+        }
+
+        ComplexNumber product(const ComplexNumber& cx) const {
+            long newReal = this->real * cx.real - this->imaginary * cx.imaginary;
+            long newImaginary = this->real * cx.imaginary + this->imaginary * cx.real;
+            return ComplexNumber(newReal, newImaginary);
+        }
+
+        static constexpr long getModulus() {
+            return MOD_NUMBER;
+        }
+
+        // Same value with both parts in [0, MOD), so that equal residues compare equal
+        ComplexNumber canonical() const {
+            ComplexNumber value;
+            value.real = this->real < 0 ? this->real + MOD_NUMBER : this->real;
+            value.imaginary = this->imaginary < 0 ? this->imaginary + MOD_NUMBER : this->imaginary;
+            return value;
         }
 
-        IComplexNumber* product(IComplexNumber* cx) {
-            long newReal = this->real * cx->getRealPart() - this->imaginary * cx->getImaginaryPart();
-            long newImaginary = this->real * cx->getImaginaryPart() + this->imaginary * cx->getRealPart();
-            return new ComplexNumber(newReal, newImaginary);
+        // 1 / (a + bi) = (a - bi) / (a^2 + b^2). Fails when a^2 + b^2 shares a factor with the
+        // modulus; never happens for a nonzero value when the modulus is a prime that is 3 mod 4.
+        bool inverse(ComplexNumber& result) const {
+            ComplexNumber value = this->canonical();
+            long norm = (value.real * value.real % MOD_NUMBER + value.imaginary * value.imaginary % MOD_NUMBER) % MOD_NUMBER;
+            long normInverse;
+            if (!inverseOf(norm, normInverse))
+                return false;
+            result = ComplexNumber(value.real * normInverse, (MOD_NUMBER - value.imaginary) * normInverse).canonical();
+            return true;
         }
 
     // Operators
     public:
+        bool operator==(const ComplexNumber& other) const {
+            return real == other.real && imaginary == other.imaginary;
+        }
+
+        bool operator!=(const ComplexNumber& other) const {
+            return !(*this == other);
+        }
 
         /*
         operator std::string() const { 
@@ -59,11 +95,39 @@ class ComplexNumber : public IComplexNumber {
         }
         */
 
+    // Private methods
+    private:
+        // Extended Euclid on (x, MOD)
+        static bool inverseOf(long x, long& result) {
+            long r0 = MOD_NUMBER, r1 = x;
+            long t0 = 0, t1 = 1;
+            while (r1 != 0) {
+                long q = r0 / r1;
+                long r = r0 - q * r1;
+                r0 = r1;
+                r1 = r;
+                long t = t0 - q * t1;
+                t0 = t1;
+                t1 = t;
+            }
+            if (r0 != 1)
+                return false;
+            result = t0 < 0 ? t0 + MOD_NUMBER : t0;
+            return true;
+        }
+
     // Internal vatiables
     private:
         long real;
         long imaginary;
-        static const long MOD_NUMBER = 580608000 + 10000;
+#ifdef TDD_PRIME_MODULUS
+        // Prime and 3 mod 4, so every nonzero weight has an inverse, see inverse()
+        static constexpr long MOD_NUMBER = 1000000007;
+#else
+        static constexpr long MOD_NUMBER = 580608000 + 10000;
+#endif
         //static const long MOD_NUMBER =   7;
 };
+
+static_assert(std::is_trivially_copyable<ComplexNumber>::value, "ComplexNumber must stay a plain value type");
 #endif
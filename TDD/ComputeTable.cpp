@@ -1,5 +1,9 @@
 #include <string>
 #include <omp.h>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <unordered_map>
 
 using namespace std;
 
@@ -10,40 +14,134 @@ using namespace std;
 
 #ifndef COMPUTE_TABLE_H // include guard
 #define COMPUTE_TABLE_H
+// Direct-mapped, lossy compute table: a power-of-two array of one cache line slots indexed
+// by the key hash. Inserts overwrite whatever entry occupied the slot, so memory is fixed
+// at construction and a lookup touches a single slot.
+//
+// The table holds a reference on every result edge. An overwritten edge may still be in use
+// by a thread that just looked it up, so it is only released by the next clear().
 class ComputeTable : public IComputeTable {
     // Constructors
     public:
-        ComputeTable() {
-            omp_init_lock(&insertLock);
+        // size is rounded up to a power of two
+        ComputeTable(std::size_t size = DEFAULT_SIZE) {
+            this->size = 1;
+            while (this->size < size)
+                this->size *= 2;
+            mask = this->size - 1;
+            slots = new Slot[this->size];
+            entries = 0;
+            omp_init_lock(&retiredLock);
+        }
+
+        ~ComputeTable() {
+            omp_destroy_lock(&retiredLock);
+            delete[] slots;
         }
     // Methods
     public: 
         IEdge* lookup(INode* node) {
             //return nullptr;                                             // -------------------------------------------------- Deactivate
-            //omp_set_lock(&insertLock);
+            NodeKey key = node->getKey();
+            Slot& slot = getSlot(key);
+            acquire(slot);
             IEdge* dev = nullptr;
-            std::size_t hashResult = std::hash<std::string>{}(node->getString());
-            if (table.find(hashResult) != table.end()) {
-                dev = table[hashResult];
+            if (slot.edge != nullptr && slot.key == key) {
+                dev = slot.edge;
             }
-            //omp_unset_lock(&insertLock);
+            release(slot);
+            counters.countLookup(dev != nullptr);
             return dev;
         }
 
         void insert(INode* inputNode, IEdge* resultEdge) {
-            std::size_t hashResult = std::hash<std::string>{}(inputNode->getString());
-            #pragma omp task
-            {
-            omp_set_lock(&insertLock);
-            table[hashResult] = resultEdge;
-            #pragma omp flush
-            omp_unset_lock(&insertLock);
+            insert(inputNode->getKey(), resultEdge);
+        }
+
+        void insert(const NodeKey& key, IEdge* resultEdge) {
+            Slot& slot = getSlot(key);
+            resultEdge->incRef();
+            acquire(slot);
+            IEdge* overwritten = slot.edge;
+            slot.key = key;
+            slot.edge = resultEdge;
+            release(slot);
+            counters.countInsert(overwritten != nullptr);
+            if (overwritten == nullptr)
+                entries.fetch_add(1, std::memory_order_relaxed);
+            if (overwritten != nullptr) {
+                omp_set_lock(&retiredLock);
+                retired.push_back(overwritten);
+                omp_unset_lock(&retiredLock);
+            }
+        }
+
+        // Visits the live entries. Must not run concurrently with inserts.
+        void forEach(std::function<void(const NodeKey&, IEdge*)> f) {
+            for (std::size_t i = 0; i < size; i++) {
+                if (slots[i].edge != nullptr)
+                    f(slots[i].key, slots[i].edge);
+            }
+        }
+
+        // Drops every entry. Must not run concurrently with lookups.
+        void clear() {
+            for (std::size_t i = 0; i < size; i++) {
+                if (slots[i].edge != nullptr) {
+                    slots[i].edge->decRef();
+                    slots[i].edge = nullptr;
+                }
             }
+            for (IEdge* edge : retired)
+                edge->decRef();
+            retired.clear();
+            entries = 0;
+        }
+
+        std::size_t getSize() {
+            return size;
+        }
+
+        // Overwrites count inserts that evicted an occupied slot
+        TableStats getStats() {
+            return counters.snapshot(entries.load(std::memory_order_relaxed));
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
         }
 
     private:
-        std::map<std::size_t, IEdge*> table;
-        omp_lock_t insertLock;
+        struct alignas(64) Slot {
+            NodeKey key = {};
+            IEdge* edge = nullptr;
+            std::atomic<bool> busy{false};
+        };
+
+        Slot& getSlot(const NodeKey& key) {
+            return slots[NodeKeyHash{}(key) & mask];
+        }
+
+        // Per-slot spin lock, held only while the slot is copied
+        static void acquire(Slot& slot) {
+            while (slot.busy.exchange(true, std::memory_order_acquire)) {
+                while (slot.busy.load(std::memory_order_relaxed));
+            }
+        }
+
+        static void release(Slot& slot) {
+            slot.busy.store(false, std::memory_order_release);
+        }
+
+    private:
+        static const std::size_t DEFAULT_SIZE = 1 << 16;
+        Slot* slots;
+        std::size_t size;
+        std::size_t mask;
+        std::atomic<long> entries;
+        std::vector<IEdge*> retired;
+        omp_lock_t retiredLock;
+        TableCounters counters;
 };
 
 class CachedComputeTable : public IComputeTable {
@@ -56,23 +154,50 @@ class CachedComputeTable : public IComputeTable {
     public: 
         IEdge* lookup(INode* node) {
             IEdge* dev = nullptr;
-            auto s = node->getString();
-            if (table.find(s) != table.end()) {
-                dev = table[s];
+            NodeKey key = node->getKey();
+            auto it = table.find(key);
+            if (it != table.end()) {
+                dev = it->second;
             } else {
                 dev = ct->lookup(node);
-                table[s] = dev;
+                table[key] = dev;
             }
+            counters.countLookup(dev != nullptr);
             return dev;
         }
         
         void insert(INode* inputNode, IEdge* resultEdge) {
-            table[inputNode->getString()] = resultEdge;
-            ct->insert(inputNode, resultEdge);
+            insert(inputNode->getKey(), resultEdge);
+        }
+
+        void insert(const NodeKey& key, IEdge* resultEdge) {
+            auto result = table.insert_or_assign(key, resultEdge);
+            counters.countInsert(!result.second);
+            ct->insert(key, resultEdge);
+        }
+
+        // The entries belong to the wrapped table
+        void forEach(std::function<void(const NodeKey&, IEdge*)> f) {
+            ct->forEach(f);
+        }
+
+        void clear() {
+            table.clear();
+            ct->clear();
+        }
+
+        // Activity of the local cache, the wrapped table keeps its own statistics
+        TableStats getStats() {
+            return counters.snapshot(table.size());
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
         }
 
     private:
-        std::map<string, IEdge*> table;
+        std::unordered_map<NodeKey, IEdge*, NodeKeyHash> table;
         IComputeTable* ct;
+        TableCounters counters;
 };
 #endif
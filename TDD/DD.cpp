@@ -1,18 +1,58 @@
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
 #include "Edge.cpp"
 #include "Node.cpp"
+#include "Arena.cpp"
+#include "Runtime.cpp"
+#include "ProductMemo.cpp"
 #include "Interfaces.cpp"
 #include "UniqueTable.cpp"
 #include "ComputeTable.cpp"
+#include "IterativeEvaluator.cpp"
 
 #ifndef DD_H // include guard
 #define DD_H
 class DD : public IDD {
     // Constructors
     public:
-        DD(IEdge* edge) {
+        DD(IEdge* edge) : DD(edge, new Arena()) {
+        }
+
+        // Takes ownership of the arena the diagram of edge was built in
+        DD(IEdge* edge, Arena* arena) : DD(edge, arena, countLevels(edge)) {
+        }
+
+        // levelSizes[l] is the number of nodes expected at level l, for callers that already
+        // know it. The unique table is sized from it, see countLevels.
+        DD(IEdge* edge, Arena* arena, const std::vector<std::size_t>& levelSizes)
+            : DD(edge, arena, createUniqueTable(levelSizes)) {
+        }
+
+        // Also takes ownership of a unique table that already holds the nodes of the diagram,
+        // see DDBuilder
+        DD(IEdge* edge, Arena* arena, LevelUniqueTable* ut) {
             headEdge = edge;
-            ut = new UniqueTable();
-            ct = new ComputeTable();
+            headEdge->incRef();
+            this->arena = arena;
+            runtime = Runtime::getDefault();
+            gcThreshold = DEFAULT_GC_THRESHOLD;
+            nextGC = gcThreshold;
+            this->ut = ut;
+            plainCt = new ComputeTable();
+            normalizedCt = nullptr;
+            ct = plainCt;
+            statsEnabled = false;
+        }
+
+        // Every node and edge of the DD lives in its arena, so they are released in one go
+        ~DD() {
+            delete ut;
+            delete plainCt;
+            delete normalizedCt;
+            delete arena;
         }
     // Interface methods
     public:
@@ -24,57 +64,415 @@ class DD : public IDD {
         IEdge* getHeadEdge() {
             return headEdge;
         }
+
+        // The compute table of the current mode, see setNormalized
+        IComputeTable* getComputeTable() {
+            return ct;
+        }
         
-        IComplexNumber* getProduct() {
+        Arena* getArena() {
+            return arena;
+        }
+
+        Runtime* getRuntime() {
+            return runtime;
+        }
+
+        // The runtime is not owned, several DDs may share one
+        void setRuntime(Runtime* runtime) {
+            this->runtime = runtime;
+        }
+
+        ComplexNumber getProduct() {
             return headEdge->getProduct();
         }
 
-        IComplexNumber* getProductParallel() {
-            return headEdge->getProductParallel();
+        ComplexNumber getProductParallel() {
+            ComplexNumber result;
+            runtime->run(arena, [&]() {
+                result = headEdge->getProductParallel();
+            });
+            return result;
         }
 
-        IComplexNumber* getDDProduct() {
-            headEdge = headEdge->getDDProduct(ut, ct);
-            return headEdge->getValue();
+        // Same value as getProduct, but a node shared by several parents is evaluated once
+        ComplexNumber getProductMemoized() {
+            ProductMemo memo;
+            return headEdge->getProductMemoized(&memo);
+        }
+
+        ComplexNumber getProductMemoizedParallel() {
+            ProductMemo memo;
+            ComplexNumber result;
+            runtime->run(arena, [&]() {
+                result = headEdge->getProductMemoizedParallel(&memo);
+            });
+            return result;
         }
 
-        IComplexNumber* getDDProductParallel(int level) {
-            #pragma omp parallel num_threads(12) shared(headEdge)
-            {
-                #pragma omp single
-                {
-                    headEdge = headEdge->getDDProductParallel(ut, ct, level);
+        ComplexNumber getDDProduct() {
+            Arena::Scope scope(arena);
+            return replaceHeadEdge(headEdge->getDDProduct(ut, ct));
+        }
+
+        // getProduct and getDDProduct without recursion, for diagrams too deep for the call stack
+        ComplexNumber getProductIterative() {
+            return evaluator.getProduct(headEdge);
+        }
+
+        ComplexNumber getDDProductIterative() {
+            Arena::Scope scope(arena);
+            return replaceHeadEdge(evaluator.getDDProduct(headEdge, ut, ct));
+        }
+
+        ComplexNumber getDDProductParallel(int level) {
+            IEdge* result = nullptr;
+            runtime->run(arena, [&]() {
+                result = headEdge->getDDProductParallel(ut, ct, level);
+            });
+            return replaceHeadEdge(result);
+        }
+
+        ComplexNumber getDDProductParallelCached(int level) {
+            IEdge* result = nullptr;
+            runtime->run(arena, [&]() {
+                result = headEdge->getDDProductParallelCached(ut, ct, level);
+            });
+            return replaceHeadEdge(result);
+        }
+
+        ComplexNumber getDDProductParallelPrivate(int level) {
+            IEdge* result = nullptr;
+            runtime->run(arena, [&]() {
+                result = headEdge->getDDProductParallelPrivate(ut, ct, level);
+            });
+            return replaceHeadEdge(result);
+        }
+
+        // Task-parallel product that decides at runtime where to split, see Node::getDDProductParallelAdaptive
+        ComplexNumber getDDProductParallelAdaptive() {
+            IEdge* result = nullptr;
+            runtime->run(arena, [&]() {
+                result = headEdge->getDDProductParallelAdaptive(ut, ct);
+            });
+            return replaceHeadEdge(result);
+        }
+
+        // Evaluates the distinct nodes of the diagram one level at a time, leaves first. A level
+        // only depends on the ones below it, so its nodes are built by a parallel loop and then
+        // hash-consed in one batch. Each node is evaluated once and the compute table is not
+        // used. Same result as getDDProduct.
+        ComplexNumber getDDProductLevelParallel() {
+            Arena::Scope scope(arena);
+            std::unordered_map<INode*, std::size_t> slots;
+            std::vector<std::vector<INode*>> levels = collectLevels(headEdge, slots);
+            // The product edge of every node of the levels done so far, as Node::getDDProduct
+            // returns it, at the slot of the node. Read concurrently, written between levels.
+            std::vector<IEdge*> products(slots.size());
+            std::vector<ComplexNumber> values;
+            std::vector<Node*> candidates;
+            // Every leaf has the product of Node::getDDProduct on a leaf, built once
+            IEdge* leafProduct = new Edge(ComplexNumber(), Node::lookupUnique(ut, nullptr, nullptr));
+            for (INode* leaf : levels[0]) {
+                leafProduct->incRef();
+                products[slots.find(leaf)->second] = leafProduct;
+            }
+            for (std::size_t level = 1; level < levels.size(); level++) {
+                std::vector<INode*>& nodes = levels[level];
+                std::size_t n = nodes.size();
+                values.resize(n);
+                candidates.resize(n);
+                auto build = [&](std::size_t i) {
+                    IEdge* leftEdge = childProduct(nodes[i]->getLeftEdge(), slots, products);
+                    IEdge* rightEdge = childProduct(nodes[i]->getRightEdge(), slots, products);
+                    ComplexNumber value = ComplexNumber();
+                    if (leftEdge != nullptr)
+                        value = value.product(leftEdge->getValue());
+                    if (rightEdge != nullptr)
+                        value = value.product(rightEdge->getValue());
+                    values[i] = value;
+                    candidates[i] = Node::createCandidate(ut, leftEdge, rightEdge);
+                };
+                if (n < MIN_PARALLEL_LEVEL) {
+                    for (std::size_t i = 0; i < n; i++)
+                        build(i);
+                } else {
+                    runtime->forEach(arena, n, build);
+                }
+                for (std::size_t i = 0; i < n; i++) {
+                    IEdge* product = new Edge(values[i], Node::lookupCandidate(ut, candidates[i]));
+                    product->incRef();
+                    products[slots.find(nodes[i])->second] = product;
                 }
             }
-            return headEdge->getValue();
+            // The head edge only refers to the node of its product edge, which can go now
+            IEdge* result = childProduct(headEdge, slots, products);
+            for (IEdge* product : products)
+                product->decRef();
+            return replaceHeadEdge(result);
         }
 
-        IComplexNumber* getDDProductParallelCached(int level) {
-            #pragma omp parallel num_threads(12) shared(headEdge)
-            {
-                #pragma omp single
-                {
-                    headEdge = headEdge->getDDProductParallelCached(ut, ct, level);
+        // Rebuilds the diagram from normalized nodes, leaves first, and collects the old ones.
+        // The weight of every edge stays, so the diagram keeps its products. A diagram that is
+        // already normalized is left as it is, see Snapshot::load.
+        void normalizeDiagram() {
+            Arena::Scope scope(arena);
+            std::unordered_map<INode*, std::size_t> slots;
+            std::vector<std::vector<INode*>> levels = collectLevels(headEdge, slots);
+            // The copy of every node, held by an edge of weight 1 at the slot of the node
+            std::vector<IEdge*> copies(slots.size());
+            bool changed = false;
+            for (std::vector<INode*>& nodes : levels) {
+                for (INode* node : nodes) {
+                    IEdge* leftEdge = childProduct(node->getLeftEdge(), slots, copies);
+                    IEdge* rightEdge = childProduct(node->getRightEdge(), slots, copies);
+                    IEdge* copy = new Edge(ComplexNumber(), Node::lookupUnique(ut, leftEdge, rightEdge));
+                    copy->incRef();
+                    copies[slots.find(node)->second] = copy;
+                    changed = changed || copy->getNode() != node;
                 }
             }
-            return headEdge->getValue();
+            IEdge* result = changed ? childProduct(headEdge, slots, copies) : nullptr;
+            for (IEdge* copy : copies)
+                copy->decRef();
+            if (changed) {
+                replaceHeadEdge(result);
+                garbageCollect();
+            }
         }
 
-        IComplexNumber* getDDProductParallelPrivate(int level) {
-            #pragma omp parallel num_threads(12) shared(headEdge)
-            {
-                #pragma omp single
-                {
-                    headEdge = headEdge->getDDProductParallelPrivate(ut, ct, level);
-                }
+        // Frees the nodes no longer reachable from the head edge. The compute table is emptied
+        // first so that it stops keeping superseded results alive.
+        std::size_t garbageCollect() {
+            plainCt->clear();
+            if (normalizedCt != nullptr)
+                normalizedCt->clear();
+            std::size_t collected = ut->garbageCollect();
+            // Live data above the threshold would otherwise trigger a collection on every call
+            nextGC = std::max(gcThreshold, 2 * arena->getAllocatedBytes());
+            return collected;
+        }
+
+        // Copies the diagram into a new arena in depth-first pre-order, left subtree first,
+        // which is the order the products visit it: each node is followed by its two child
+        // edges and then by its left and right subtrees. The copies replace the old nodes in
+        // a new unique table, unreachable nodes are dropped and the compute tables emptied,
+        // as their keys name the old nodes. Returns the number of nodes copied.
+        std::size_t compactLayout() {
+            plainCt->clear();
+            if (normalizedCt != nullptr)
+                normalizedCt->clear();
+            Arena* compact = new Arena();
+            Arena::Scope scope(compact);
+            // A node needs its children to be built, so the blocks are reserved in pre-order
+            // first and filled afterwards
+            std::unordered_map<INode*, Relocation<INode>> nodes;
+            std::unordered_map<IEdge*, Relocation<IEdge>> edges;
+            nodes.reserve(ut->getStats().entries);
+            edges.reserve(2 * ut->getStats().entries);
+            reserveEdge(headEdge, edges);
+            std::vector<INode*> order;
+            std::vector<std::size_t> levelSizes;
+            std::vector<INode*> pending = {headEdge->getNode()};
+            while (!pending.empty()) {
+                INode* node = pending.back();
+                pending.pop_back();
+                if (!nodes.emplace(node, Relocation<INode>{Node::operator new(sizeof(Node)), nullptr}).second)
+                    continue;
+                order.push_back(node);
+                if ((std::size_t) node->getLevel() >= levelSizes.size())
+                    levelSizes.resize(node->getLevel() + 1);
+                levelSizes[node->getLevel()]++;
+                reserveEdge(node->getLeftEdge(), edges);
+                reserveEdge(node->getRightEdge(), edges);
+                if (node->getRightEdge() != nullptr)
+                    pending.push_back(node->getRightEdge()->getNode());
+                if (node->getLeftEdge() != nullptr)
+                    pending.push_back(node->getLeftEdge()->getNode());
+            }
+            // Nodes sit above their children, see Node::getLevel, so filling the blocks level
+            // by level from the leaves up builds every child first
+            std::stable_sort(order.begin(), order.end(), [](INode* a, INode* b) {
+                return a->getLevel() < b->getLevel();
+            });
+            LevelUniqueTable* table = createUniqueTable(levelSizes);
+            table->setNormalized(ut->isNormalized());
+            table->setStatsEnabled(statsEnabled);
+            for (INode* node : order) {
+                IEdge* leftEdge = copyEdge(node->getLeftEdge(), nodes, edges);
+                IEdge* rightEdge = copyEdge(node->getRightEdge(), nodes, edges);
+                Relocation<INode>& relocation = nodes.find(node)->second;
+                relocation.copy = Node::lookupCandidate(table, ::new (relocation.block) Node(leftEdge, rightEdge));
+            }
+            IEdge* head = copyEdge(headEdge, nodes, edges);
+            head->incRef();
+            for (auto& entry : edges)
+                entry.second.copy->decRef();
+            // Everything the old arena holds goes at once
+            delete ut;
+            delete arena;
+            ut = table;
+            arena = compact;
+            headEdge = head;
+            nextGC = std::max(gcThreshold, 2 * arena->getAllocatedBytes());
+            return order.size();
+        }
+
+        // Counting is off by default, see TableCounters
+        void setTableStatsEnabled(bool enabled) {
+            statsEnabled = enabled;
+            ut->setStatsEnabled(enabled);
+            plainCt->setStatsEnabled(enabled);
+            if (normalizedCt != nullptr)
+                normalizedCt->setStatsEnabled(enabled);
+        }
+
+        // In normalized mode every node built moves a scalar between its child weights, see
+        // Node::lookupUnique. The products are the same in both modes, the diagrams differ in
+        // their weights, so each mode has its own compute table. Switching the mode on also
+        // normalizes the diagram, which the products then share nodes with.
+        void setNormalized(bool normalized) {
+            bool switchedOn = normalized && !ut->isNormalized();
+            ut->setNormalized(normalized);
+            if (switchedOn)
+                normalizeDiagram();
+            if (normalized && normalizedCt == nullptr) {
+                normalizedCt = new ComputeTable();
+                normalizedCt->setStatsEnabled(statsEnabled);
             }
+            ct = normalized ? normalizedCt : plainCt;
+        }
+
+        bool isNormalized() {
+            return ut->isNormalized();
+        }
+
+        DDTableStats getTableStats() {
+            DDTableStats stats;
+            stats.unique = ut->getStats();
+            stats.compute = ct->getStats();
+            return stats;
+        }
+
+        // garbageCollect() runs after a product once the arena holds more than bytes
+        void setGCThreshold(std::size_t bytes) {
+            gcThreshold = bytes;
+            nextGC = bytes;
+        }
+
+        std::size_t getGCThreshold() {
+            return gcThreshold;
+        }
+
+    // Private methods
+    private:
+        // The distinct nodes of the diagram of edge, grouped by Node::getLevel. slots numbers
+        // them in the order they are found.
+        static std::vector<std::vector<INode*>> collectLevels(IEdge* edge, std::unordered_map<INode*, std::size_t>& slots) {
+            std::vector<std::vector<INode*>> levels;
+            std::vector<INode*> pending = {edge->getNode()};
+            while (!pending.empty()) {
+                INode* node = pending.back();
+                pending.pop_back();
+                if (!slots.emplace(node, slots.size()).second)
+                    continue;
+                if ((std::size_t) node->getLevel() >= levels.size())
+                    levels.resize(node->getLevel() + 1);
+                levels[node->getLevel()].push_back(node);
+                if (node->getLeftEdge() != nullptr)
+                    pending.push_back(node->getLeftEdge()->getNode());
+                if (node->getRightEdge() != nullptr)
+                    pending.push_back(node->getRightEdge()->getNode());
+            }
+            return levels;
+        }
+
+        // Products keep the shape of the diagram, so each level of the unique table is sized
+        // for the nodes the input has at that level
+        static std::vector<std::size_t> countLevels(IEdge* edge) {
+            std::unordered_map<INode*, std::size_t> slots;
+            std::vector<std::vector<INode*>> levels = collectLevels(edge, slots);
+            std::vector<std::size_t> levelSizes(levels.size());
+            for (std::size_t level = 0; level < levels.size(); level++)
+                levelSizes[level] = levels[level].size();
+            return levelSizes;
+        }
+
+        // Deep levels are summed into the shared last sub-table, reserving it once per level
+        // would rehash it every time
+        static LevelUniqueTable* createUniqueTable(const std::vector<std::size_t>& levelSizes) {
+            LevelUniqueTable* table = new LevelUniqueTable();
+            if (levelSizes.empty())
+                return table;
+            std::vector<std::size_t> population(std::min<std::size_t>(levelSizes.size(), table->getNumLevels()));
+            for (std::size_t level = 0; level < levelSizes.size(); level++)
+                population[std::min<std::size_t>(level, population.size() - 1)] += levelSizes[level];
+            for (std::size_t level = 0; level < population.size(); level++)
+                table->reserve(level, population[level]);
+            return table;
+        }
+
+        // The end of Edge::getDDProduct, with the product edge of the child node already known
+        static IEdge* childProduct(IEdge* edge, std::unordered_map<INode*, std::size_t>& slots,
+                                   std::vector<IEdge*>& products) {
+            if (edge == nullptr)
+                return nullptr;
+            IEdge* product = products[slots.find(edge->getNode())->second];
+            return new Edge(product->getValue().product(edge->getValue()), product->getNode());
+        }
+
+        // The block reserved for the copy of a node or edge in compactLayout, and the copy
+        template<typename T>
+        struct Relocation {
+            void* block;
+            T* copy;
+        };
+
+        static void reserveEdge(IEdge* edge, std::unordered_map<IEdge*, Relocation<IEdge>>& edges) {
+            if (edge != nullptr && edges.count(edge) == 0)
+                edges.emplace(edge, Relocation<IEdge>{Edge::operator new(sizeof(Edge)), nullptr});
+        }
+
+        // The copy of edge in compactLayout, its node is already copied. The copies are held
+        // until the end, a node dropped as a duplicate must not take a shared edge with it.
+        static IEdge* copyEdge(IEdge* edge, std::unordered_map<INode*, Relocation<INode>>& nodes,
+                               std::unordered_map<IEdge*, Relocation<IEdge>>& edges) {
+            if (edge == nullptr)
+                return nullptr;
+            Relocation<IEdge>& relocation = edges.find(edge)->second;
+            if (relocation.copy == nullptr) {
+                INode* node = nodes.find(edge->getNode())->second.copy;
+                relocation.copy = ::new (relocation.block) Edge(edge->getValue(), node);
+                relocation.copy->incRef();
+            }
+            return relocation.copy;
+        }
+
+        ComplexNumber replaceHeadEdge(IEdge* edge) {
+            edge->incRef();
+            headEdge->decRef();
+            headEdge = edge;
+            if (arena->getAllocatedBytes() > nextGC)
+                garbageCollect();
             return headEdge->getValue();
         }
-    
+
     private:
+        static const std::size_t DEFAULT_GC_THRESHOLD = (std::size_t) 1 << 30;
+        // Levels with fewer nodes are built by the calling thread alone
+        static const std::size_t MIN_PARALLEL_LEVEL = 256;
+
         IEdge* headEdge;
+        Arena* arena;
+        Runtime* runtime;
         IUniqueTable* ut;
+        // The table of the current mode, one of the two below
         IComputeTable* ct;
-
+        IComputeTable* plainCt;
+        IComputeTable* normalizedCt;
+        bool statsEnabled;
+        IterativeEvaluator evaluator;
+        std::size_t gcThreshold;
+        std::size_t nextGC;
 };
 #endif
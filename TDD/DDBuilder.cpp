@@ -0,0 +1,182 @@
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include "DD.cpp"
+#include "Edge.cpp"
+#include "Node.cpp"
+#include "Arena.cpp"
+#include "Runtime.cpp"
+#include "NodeKey.cpp"
+#include "Interfaces.cpp"
+#include "UniqueTable.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef DD_BUILDER_H // include guard
+#define DD_BUILDER_H
+// Builds a diagram bottom-up in reduced form. Every node goes through the unique table as it
+// is created, so equal subdiagrams are built once and a diagram never holds more nodes than
+// its reduced size. Equal edges (same weight, same node) are shared through a direct-mapped
+// cache like ComputeTable: an edge evicted from its slot is only built again.
+//
+// leaves and pairs build a whole level at once: the weights are generated and the nodes
+// hash-consed by the threads of the runtime, each level spread over the shards of the
+// unique table. Only the edges are made by the calling thread, through the cache.
+//
+// The builder keeps a reference to each edge it hands out. build() passes the arena and the
+// unique table to the new DD and drops those references, which frees the edges the diagram
+// does not use. The builder then starts over with a fresh arena.
+class DDBuilder {
+    // Constructors
+    public:
+        // cacheSize is rounded up to a power of two
+        DDBuilder(std::size_t cacheSize = DEFAULT_CACHE_SIZE) {
+            this->cacheSize = 1;
+            while (this->cacheSize < cacheSize)
+                this->cacheSize *= 2;
+            cache = new IEdge*[this->cacheSize];
+            runtime = Runtime::getDefault();
+            start();
+        }
+
+        ~DDBuilder() {
+            delete[] cache;
+            delete ut;
+            delete arena;
+        }
+
+        DDBuilder(const DDBuilder&) = delete;
+        DDBuilder& operator=(const DDBuilder&) = delete;
+
+    // Methods
+    public:
+        // Edge of the given weight to the leaf
+        IEdge* leaf(ComplexNumber weight) {
+            Arena::Scope scope(arena);
+            if (leafNode == nullptr)
+                leafNode = Node::lookupUnique(ut, nullptr, nullptr);
+            return edge(weight, leafNode);
+        }
+
+        // Edge of the given weight to the node with these children, either may be nullptr
+        IEdge* node(ComplexNumber weight, IEdge* leftEdge, IEdge* rightEdge) {
+            Arena::Scope scope(arena);
+            return edge(weight, Node::lookupUnique(ut, leftEdge, rightEdge));
+        }
+
+        // n edges to the leaf, edge i of weight weight(i). weight is called concurrently.
+        std::vector<IEdge*> leaves(std::size_t n, std::function<ComplexNumber(std::size_t)> weight) {
+            std::vector<ComplexNumber> weights(n);
+            forEach(n, [&](std::size_t i) {
+                weights[i] = weight(i);
+            });
+            std::vector<IEdge*> result(n);
+            for (std::size_t i = 0; i < n; i++)
+                result[i] = leaf(weights[i]);
+            return result;
+        }
+
+        // The level above children: edge i, of weight weight(i), goes to the node with children
+        // 2i and 2i + 1. An odd last child is dropped. weight is called concurrently.
+        std::vector<IEdge*> pairs(const std::vector<IEdge*>& children, std::function<ComplexNumber(std::size_t)> weight) {
+            std::size_t n = children.size() / 2;
+            std::vector<ComplexNumber> weights(n);
+            std::vector<INode*> nodes(n);
+            forEach(n, [&](std::size_t i) {
+                weights[i] = weight(i);
+                nodes[i] = Node::lookupUnique(ut, children[2*i], children[2*i+1]);
+            });
+            Arena::Scope scope(arena);
+            std::vector<IEdge*> result(n);
+            for (std::size_t i = 0; i < n; i++)
+                result[i] = edge(weights[i], nodes[i]);
+            return result;
+        }
+
+        // Complete binary tree of 2^depth leaves, leaf i of weight leafWeight(i) and node i of
+        // level l of weight nodeWeight(l, i), built a level at a time
+        DD* tree(int depth, std::function<ComplexNumber(std::size_t)> leafWeight,
+                 std::function<ComplexNumber(int, std::size_t)> nodeWeight) {
+            std::vector<IEdge*> level = leaves((std::size_t) 1 << depth, leafWeight);
+            for (int l = 1; l <= depth; l++) {
+                level = pairs(level, [&](std::size_t i) {
+                    return nodeWeight(l, i);
+                });
+            }
+            return build(level[0]);
+        }
+
+        // The runtime is not owned, see DD::setRuntime
+        void setRuntime(Runtime* runtime) {
+            this->runtime = runtime;
+        }
+
+        // Nodes in the unique table and edges built so far
+        std::size_t getNodeCount() {
+            return ut->getStats().entries;
+        }
+
+        std::size_t getEdgeCount() {
+            return edges.size();
+        }
+
+        // The DD of head, which must come from this builder
+        DD* build(IEdge* head) {
+            DD* dd = new DD(head, arena, ut);
+            for (IEdge* edge : edges)
+                edge->decRef();
+            start();
+            return dd;
+        }
+
+    // Private methods
+    private:
+        void start() {
+            arena = new Arena();
+            ut = new LevelUniqueTable(LevelUniqueTable::DEFAULT_LEVELS, NUM_SHARDS);
+            leafNode = nullptr;
+            edges.clear();
+            std::fill(cache, cache + cacheSize, nullptr);
+        }
+
+        // Small levels are built by the calling thread alone
+        template<typename F>
+        void forEach(std::size_t n, F f) {
+            if (n < MIN_PARALLEL_LEVEL) {
+                Arena::Scope scope(arena);
+                for (std::size_t i = 0; i < n; i++)
+                    f(i);
+            } else {
+                runtime->forEach(arena, n, f);
+            }
+        }
+
+        IEdge* edge(ComplexNumber weight, INode* node) {
+            uint64_t h = NodeKeyHash::mix(node->getId());
+            h = NodeKeyHash::mix(h ^ (uint64_t) weight.getRealPart());
+            h = NodeKeyHash::mix(h ^ (uint64_t) weight.getImaginaryPart());
+            IEdge*& slot = cache[h & (cacheSize - 1)];
+            if (slot != nullptr && slot->getNode() == node && slot->getValue() == weight)
+                return slot;
+            slot = new Edge(weight, node);
+            slot->incRef();
+            edges.push_back(slot);
+            return slot;
+        }
+
+    private:
+        static const std::size_t DEFAULT_CACHE_SIZE = (std::size_t) 1 << 16;
+        static const std::size_t MIN_PARALLEL_LEVEL = 256;
+        static const int NUM_SHARDS = 16;
+
+        Arena* arena;
+        Runtime* runtime;
+        LevelUniqueTable* ut;
+        INode* leafNode;
+        IEdge** cache;
+        std::size_t cacheSize;
+        // Every edge built, each holding one reference of the builder
+        std::vector<IEdge*> edges;
+};
+#endif
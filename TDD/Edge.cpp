@@ -1,5 +1,9 @@
+#include <atomic>
+
 #include "utils.cpp"
+#include "Arena.cpp"
 #include "Interfaces.cpp"
+#include "ProductMemo.cpp"
 #include "ComplexNumber.cpp"
 
 #ifndef EDGE_H // include guard
@@ -8,23 +12,56 @@ class Edge: public IEdge {
 
     // Constructors
     public:
-        Edge(long n, INode* node) {
+        Edge(long n, INode* node) : refCount(0) {
             this->node = node;
-            this->n = new ComplexNumber(n);
+            this->n = ComplexNumber(n);
+            if (node != nullptr)
+                node->incRef();
         }
 
-        Edge(IComplexNumber* n, INode* node) {
+        Edge(ComplexNumber n, INode* node) : refCount(0) {
             this->node = node;
             this->n = n;
+            if (node != nullptr)
+                node->incRef();
+        }
+
+        ~Edge() {
+            if (node != nullptr)
+                node->decRef();
+        }
+
+    // Allocation
+    public:
+        static void* operator new(std::size_t size) {
+            return Arena::allocateCurrent(size);
+        }
+
+        static void operator delete(void* p, std::size_t size) {
+            Arena::deallocate(p, size);
         }
 
     // Interface methods
     public:
-        IComplexNumber* getValue() {
+        void incRef() {
+            refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Edges are not hash-consed, so the last reference going away frees the edge
+        void decRef() {
+            if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        int getRefCount() {
+            return refCount.load(std::memory_order_relaxed);
+        }
+
+        ComplexNumber getValue() {
             return this->n;
         }
         
-        IComplexNumber* getProduct() {
+        ComplexNumber getProduct() {
             return node->getProduct(n);
         }
 
@@ -33,20 +70,43 @@ class Edge: public IEdge {
         }
 
         string getString() {
-            return  string_format("%s%i", n->get_string(), node);
+            return  string_format("%s%i", n.get_string().c_str(), node);
         }
 
-        IComplexNumber* getProductParallel() {
+        ComplexNumber getProductParallel() {
             return node->getProductParallel(n);
         }
 
+        // An edge under several parents is evaluated once, see ProductMemo
+        ComplexNumber getProductMemoized(ProductMemo* memo) {
+            if (getRefCount() <= 1)
+                return node->getProductMemoized(n, memo);
+            ComplexNumber value;
+            if (!memo->lookup(this, value)) {
+                value = node->getProductMemoized(n, memo);
+                memo->insert(this, value);
+            }
+            return value;
+        }
+
+        ComplexNumber getProductMemoizedParallel(ProductMemo* memo) {
+            if (getRefCount() <= 1)
+                return node->getProductMemoizedParallel(n, memo);
+            ComplexNumber value;
+            if (!memo->lookup(this, value)) {
+                value = node->getProductMemoizedParallel(n, memo);
+                memo->insert(this, value);
+            }
+            return value;
+        }
+
         IEdge* getDDProduct(IUniqueTable* ut, IComputeTable* ct) {
             IEdge* edge = ct->lookup(node);
             if (edge == nullptr) {
-                edge = node->getDDProduct(new ComplexNumber(), ut, ct);
+                edge = node->getDDProduct(ComplexNumber(), ut, ct);
                 ct->insert(node, edge);
             }
-            return new Edge(edge->getValue()->product(n), edge->getNode());
+            return new Edge(edge->getValue().product(n), edge->getNode());
         }
 
         IEdge* getDDProductParallel(IUniqueTable* ut, IComputeTable* ct) {
@@ -56,10 +116,10 @@ class Edge: public IEdge {
         IEdge* getDDProductParallel(IUniqueTable* ut, IComputeTable* ct, int level) {
             IEdge* edge = ct->lookup(node);
             if (edge == nullptr) {
-                edge = node->getDDProductParallel(new ComplexNumber(), ut, ct, level);
+                edge = node->getDDProductParallel(ComplexNumber(), ut, ct, level);
                 ct->insert(node, edge);
             }
-            return new Edge(edge->getValue()->product(n), edge->getNode());
+            return new Edge(edge->getValue().product(n), edge->getNode());
         }
 
         IEdge* getDDProductParallelCached(IUniqueTable* ut, IComputeTable* ct) {
@@ -69,23 +129,33 @@ class Edge: public IEdge {
         IEdge* getDDProductParallelCached(IUniqueTable* ut, IComputeTable* ct, int level) {
             IEdge* edge = ct->lookup(node);
             if (edge == nullptr) {
-                edge = node->getDDProductParallelCached(new ComplexNumber(), ut, ct, level);
+                edge = node->getDDProductParallelCached(ComplexNumber(), ut, ct, level);
                 ct->insert(node, edge);
             }
-            return new Edge(edge->getValue()->product(n), edge->getNode());
+            return new Edge(edge->getValue().product(n), edge->getNode());
         }
 
         IEdge* getDDProductParallelPrivate(IUniqueTable* ut, IComputeTable* ct, int level) {
             IEdge* edge = ct->lookup(node);
             if (edge == nullptr) {
-                edge = node->getDDProductParallelPrivate(new ComplexNumber(), ut, ct, level);
+                edge = node->getDDProductParallelPrivate(ComplexNumber(), ut, ct, level);
+                ct->insert(node, edge);
+            }
+            return new Edge(edge->getValue().product(n), edge->getNode());
+        }
+
+        IEdge* getDDProductParallelAdaptive(IUniqueTable* ut, IComputeTable* ct) {
+            IEdge* edge = ct->lookup(node);
+            if (edge == nullptr) {
+                edge = node->getDDProductParallelAdaptive(ComplexNumber(), ut, ct);
                 ct->insert(node, edge);
             }
-            return new Edge(edge->getValue()->product(n), edge->getNode());
+            return new Edge(edge->getValue().product(n), edge->getNode());
         }
 
     private:
         INode* node;
-        IComplexNumber* n;
+        ComplexNumber n;
+        std::atomic<int> refCount;
 };
 #endif
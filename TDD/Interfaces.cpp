@@ -1,62 +1,102 @@
+#include <functional>
+
+#include "NodeKey.cpp"
+#include "ComplexNumber.cpp"
+#include "TableStats.cpp"
+
 #ifndef INTERFACES_H // include guard
 #define INTERFACES_H
 
-class IComplexNumber {
-    public:
-        virtual void normalize() = 0;
-        virtual long getRealPart() = 0;
-        virtual string get_string() = 0;
-        virtual long getImaginaryPart() = 0;
-        virtual IComplexNumber* product(IComplexNumber* cx) = 0;
-};
-
 class IUniqueTable;
 
+class ProductMemo;
+
 class IComputeTable;
 
 class IEdge;
 
 class INode {
     public:
+        virtual ~INode() {}
+        virtual void incRef() = 0;
+        virtual void decRef() = 0;
+        virtual int getRefCount() = 0;
+        virtual uint64_t getId() = 0;
+        virtual int getLevel() = 0;
+        virtual NodeKey getKey() = 0;
         virtual string getString() = 0;
         virtual IEdge* getLeftEdge() = 0;
         virtual IEdge* getRightEdge() = 0;
-        virtual IComplexNumber* getProduct(IComplexNumber* n) = 0;
-        virtual IComplexNumber* getProductParallel(IComplexNumber* n) = 0;
-        virtual IEdge* getDDProduct(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct) = 0;
-        virtual IEdge* getDDProductParallel(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
-        virtual IEdge* getDDProductParallelCached(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
-        virtual IEdge* getDDProductParallelPrivate(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
+        virtual ComplexNumber getProduct(ComplexNumber n) = 0;
+        virtual ComplexNumber getProductParallel(ComplexNumber n) = 0;
+        virtual ComplexNumber getProductMemoized(ComplexNumber n, ProductMemo* memo) = 0;
+        virtual ComplexNumber getProductMemoizedParallel(ComplexNumber n, ProductMemo* memo) = 0;
+        virtual IEdge* getDDProduct(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct) = 0;
+        virtual IEdge* getDDProductParallel(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
+        virtual IEdge* getDDProductParallelCached(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
+        virtual IEdge* getDDProductParallelPrivate(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) = 0;
+        virtual IEdge* getDDProductParallelAdaptive(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct) = 0;
 };
 
 class IEdge {
     public:
-        virtual IComplexNumber* getValue() = 0;
+        virtual ~IEdge() {}
+        virtual void incRef() = 0;
+        virtual void decRef() = 0;
+        virtual int getRefCount() = 0;
+        virtual ComplexNumber getValue() = 0;
         virtual INode* getNode() = 0;
-        virtual IComplexNumber* getProduct() = 0;
+        virtual ComplexNumber getProduct() = 0;
         virtual string getString() = 0;
-        virtual IComplexNumber* getProductParallel() = 0;
+        virtual ComplexNumber getProductParallel() = 0;
+        virtual ComplexNumber getProductMemoized(ProductMemo* memo) = 0;
+        virtual ComplexNumber getProductMemoizedParallel(ProductMemo* memo) = 0;
         virtual IEdge* getDDProduct(IUniqueTable* ut, IComputeTable* ct) = 0;
         virtual IEdge* getDDProductParallel(IUniqueTable* ut, IComputeTable* ct) = 0;
         virtual IEdge* getDDProductParallelCached(IUniqueTable* ut, IComputeTable* ct) = 0;
         virtual IEdge* getDDProductParallel(IUniqueTable* ut, IComputeTable* ct, int level) = 0;
         virtual IEdge* getDDProductParallelCached(IUniqueTable* ut, IComputeTable* ct, int level) = 0;
         virtual IEdge* getDDProductParallelPrivate(IUniqueTable* ut, IComputeTable* ct, int level) = 0;
+        virtual IEdge* getDDProductParallelAdaptive(IUniqueTable* ut, IComputeTable* ct) = 0;
 };
 
 class IComputeTable {
     public:
+        virtual ~IComputeTable() {}
         virtual IEdge* lookup(INode* node) = 0;
         virtual void insert(INode* inputNode, IEdge* resultEdge) = 0;
+        virtual void insert(const NodeKey& key, IEdge* resultEdge) = 0;
+        virtual void forEach(std::function<void(const NodeKey&, IEdge*)> f) = 0;
+        virtual void clear() = 0;
+        virtual TableStats getStats() = 0;
+        virtual void setStatsEnabled(bool enabled) = 0;
 };
 
 class IUniqueTable {
     public:
+        virtual ~IUniqueTable() {}
         virtual INode* lookup(INode* node) = 0;
+        virtual void forEach(std::function<void(INode*)> f) = 0;
+        virtual std::size_t garbageCollect() = 0;
+        virtual TableStats getStats() = 0;
+        virtual void setStatsEnabled(bool enabled) = 0;
+
+        // Nodes looked up here get normalized child weights, see Node::lookupUnique
+        virtual void setNormalized(bool normalized) {
+            this->normalized = normalized;
+        }
+
+        virtual bool isNormalized() {
+            return normalized;
+        }
+
+    private:
+        bool normalized = false;
 };
 
 class IDD {
     public:
+        virtual ~IDD() {}
         virtual IUniqueTable* getUniqueTable() = 0;
 };
 #endif
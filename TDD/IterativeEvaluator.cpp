@@ -0,0 +1,133 @@
+#include <vector>
+
+#include "Edge.cpp"
+#include "Node.cpp"
+#include "Interfaces.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef ITERATIVE_EVALUATOR_H // include guard
+#define ITERATIVE_EVALUATOR_H
+// Post-order evaluation with an explicit stack instead of the Edge/Node recursion, for
+// diagrams deeper than the call stack allows. Children are visited left then right and every
+// table access happens in the order of the recursive version, so the unique and compute
+// tables end up with the same entries and the results are the same.
+//
+// The stacks are kept between calls. An evaluator is not thread safe, use one per thread.
+class IterativeEvaluator {
+    // Methods
+    public:
+        // Same as edge->getProduct()
+        ComplexNumber getProduct(IEdge* edge) {
+            ComplexNumber result;
+            productStack.clear();
+            if (!pushProduct(edge, result))
+                return result;
+            while (!productStack.empty()) {
+                ProductFrame& frame = productStack.back();
+                if (frame.stage == 0) {
+                    frame.stage = 1;
+                    if (frame.left != nullptr && pushProduct(frame.left, result))
+                        continue;
+                }
+                if (frame.stage == 1) {
+                    if (frame.left != nullptr)
+                        frame.value = frame.value.product(result);
+                    frame.stage = 2;
+                    if (frame.right != nullptr && pushProduct(frame.right, result))
+                        continue;
+                }
+                if (frame.right != nullptr)
+                    frame.value = frame.value.product(result);
+                result = frame.value;
+                productStack.pop_back();
+            }
+            return result;
+        }
+
+        // Same as edge->getDDProduct(ut, ct)
+        IEdge* getDDProduct(IEdge* edge, IUniqueTable* ut, IComputeTable* ct) {
+            // The edge a frame produced, or that a compute table hit delivered, waits here
+            // for the parent frame to pick it up
+            IEdge* result = nullptr;
+            ddStack.clear();
+            if (!lookupCached(edge, ct, result))
+                ddStack.push_back({edge, nullptr, 0});
+            while (!ddStack.empty()) {
+                DDFrame& frame = ddStack.back();
+                INode* node = frame.edge->getNode();
+                if (frame.stage == 0) {
+                    frame.stage = 1;
+                    result = nullptr;
+                    if (node->getLeftEdge() != nullptr && !lookupCached(node->getLeftEdge(), ct, result)) {
+                        ddStack.push_back({node->getLeftEdge(), nullptr, 0});
+                        continue;
+                    }
+                }
+                if (frame.stage == 1) {
+                    frame.left = result;
+                    frame.stage = 2;
+                    result = nullptr;
+                    if (node->getRightEdge() != nullptr && !lookupCached(node->getRightEdge(), ct, result)) {
+                        ddStack.push_back({node->getRightEdge(), nullptr, 0});
+                        continue;
+                    }
+                }
+                // Node::getDDProduct followed by the end of Edge::getDDProduct
+                IEdge* leftEdge = frame.left;
+                IEdge* rightEdge = result;
+                ComplexNumber value = ComplexNumber();
+                if (leftEdge != nullptr)
+                    value = value.product(leftEdge->getValue());
+                if (rightEdge != nullptr)
+                    value = value.product(rightEdge->getValue());
+                IEdge* product = new Edge(value, Node::lookupUnique(ut, leftEdge, rightEdge));
+                ct->insert(node, product);
+                result = new Edge(product->getValue().product(frame.edge->getValue()), product->getNode());
+                ddStack.pop_back();
+            }
+            return result;
+        }
+
+    // Private methods
+    private:
+        // The children are read once, when the frame is pushed
+        struct ProductFrame {
+            ComplexNumber value;
+            IEdge* left;
+            IEdge* right;
+            int stage;
+        };
+
+        struct DDFrame {
+            IEdge* edge;
+            IEdge* left;
+            int stage;
+        };
+
+        // The value of an edge to a leaf is its weight, it goes straight to result
+        bool pushProduct(IEdge* edge, ComplexNumber& result) {
+            INode* node = edge->getNode();
+            IEdge* left = node->getLeftEdge();
+            IEdge* right = node->getRightEdge();
+            if (left == nullptr && right == nullptr) {
+                result = edge->getValue();
+                return false;
+            }
+            productStack.push_back({edge->getValue(), left, right, 0});
+            return true;
+        }
+
+        // The start of Edge::getDDProduct: on a hit, result is the product edge of edge
+        static bool lookupCached(IEdge* edge, IComputeTable* ct, IEdge*& result) {
+            IEdge* cached = ct->lookup(edge->getNode());
+            if (cached == nullptr)
+                return false;
+            result = new Edge(cached->getValue().product(edge->getValue()), cached->getNode());
+            return true;
+        }
+
+    private:
+        std::vector<ProductFrame> productStack;
+        std::vector<DDFrame> ddStack;
+};
+#endif
@@ -0,0 +1,215 @@
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Snapshot.cpp"
+#include "Interfaces.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef MAPPED_DD_H // include guard
+#define MAPPED_DD_H
+// Read-only DD evaluated in place from a memory-mapped file. The file is a header and one
+// fixed-size record per node, children before parents. A record holds its child references
+// as byte offsets from the start of the file, 0 for a missing child, and both child weights
+// inline, so the file has no pointers and is mapped as is: opening it costs the same for any
+// size, and processes mapping the same file share its pages in the page cache.
+//
+// The evaluators make one pass over the records in file order, keeping one value per node in
+// a private array. Child offsets are checked as they are read. Records are in the byte order
+// of the machine that wrote them.
+class MappedDD {
+    // Constructors
+    public:
+        MappedDD(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("MappedDD: cannot open " + path + ": " + std::strerror(errno));
+            struct stat status;
+            if (fstat(fd, &status) != 0) {
+                close(fd);
+                throw std::runtime_error("MappedDD: cannot stat " + path + ": " + std::strerror(errno));
+            }
+            size = status.st_size;
+            if (size < sizeof(Header)) {
+                close(fd);
+                throw std::runtime_error("MappedDD: " + path + " is too short");
+            }
+            base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (base == MAP_FAILED)
+                throw std::runtime_error("MappedDD: cannot map " + path + ": " + std::strerror(errno));
+            header = static_cast<const Header*>(base);
+            records = reinterpret_cast<const Record*>(static_cast<const char*>(base) + sizeof(Header));
+            if (header->magic != MAGIC || header->version != VERSION || header->recordSize != sizeof(Record)) {
+                munmap(base, size);
+                throw std::runtime_error("MappedDD: " + path + " is not a mapped DD of this version");
+            }
+            if (header->modulus != ComplexNumber::getModulus()) {
+                munmap(base, size);
+                throw std::runtime_error("MappedDD: " + path + " was written with another modulus");
+            }
+            if (header->numNodes == 0 || header->numNodes > (size - sizeof(Header)) / sizeof(Record)) {
+                munmap(base, size);
+                throw std::runtime_error("MappedDD: " + path + " is truncated");
+            }
+        }
+
+        ~MappedDD() {
+            munmap(base, size);
+        }
+
+        MappedDD(const MappedDD&) = delete;
+        MappedDD& operator=(const MappedDD&) = delete;
+
+    // Methods
+    public:
+        // Writes the diagram under edge in the mapped format
+        static void save(IEdge* edge, const std::string& path) {
+            std::vector<INode*> roots = {edge->getNode()};
+            std::vector<INode*> nodes = Snapshot::collectNodes(roots);
+            std::unordered_map<INode*, uint64_t> offsets;
+            for (std::size_t i = 0; i < nodes.size(); i++)
+                offsets.emplace(nodes[i], sizeof(Header) + i * sizeof(Record));
+
+            std::vector<Record> fileRecords(nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                fileRecords[i].left = writeEdge(nodes[i]->getLeftEdge(), offsets, fileRecords[i].leftWeight);
+                fileRecords[i].right = writeEdge(nodes[i]->getRightEdge(), offsets, fileRecords[i].rightWeight);
+            }
+            Header fileHeader = {};
+            fileHeader.magic = MAGIC;
+            fileHeader.version = VERSION;
+            fileHeader.recordSize = sizeof(Record);
+            fileHeader.modulus = ComplexNumber::getModulus();
+            fileHeader.numNodes = nodes.size();
+            fileHeader.head = writeEdge(edge, offsets, fileHeader.headWeight);
+
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(Header));
+            out.write(reinterpret_cast<const char*>(fileRecords.data()), fileRecords.size() * sizeof(Record));
+            if (!out)
+                throw std::runtime_error("MappedDD: cannot write " + path);
+        }
+
+        std::size_t getNodeCount() {
+            return header->numNodes;
+        }
+
+        std::size_t getFileBytes() {
+            return size;
+        }
+
+        ComplexNumber getHeadWeight() {
+            return toComplex(header->headWeight);
+        }
+
+        // Same as Edge::getProduct on the head edge. A node keeps the values of its two child
+        // edges, which getProduct multiplies in that order into the weight of the parent edge.
+        ComplexNumber getProduct() {
+            std::size_t n = header->numNodes;
+            std::vector<ComplexNumber> first(n);
+            std::vector<ComplexNumber> second(n);
+            for (std::size_t i = 0; i < n; i++) {
+                const Record& record = records[i];
+                if (record.left != 0)
+                    first[i] = edgeProduct(record.leftWeight, childIndex(record.left, i), first, second);
+                if (record.right != 0)
+                    second[i] = edgeProduct(record.rightWeight, childIndex(record.right, i), first, second);
+            }
+            return edgeProduct(header->headWeight, childIndex(header->head, n), first, second);
+        }
+
+        // Head value DD::getDDProduct would return for this diagram. The file is read-only,
+        // so the product diagram itself is not built.
+        ComplexNumber getDDProduct() {
+            std::size_t n = header->numNodes;
+            // values[i] is the weight of the edge Node::getDDProduct returns for node i
+            std::vector<ComplexNumber> values(n);
+            for (std::size_t i = 0; i < n; i++) {
+                const Record& record = records[i];
+                ComplexNumber value = ComplexNumber();
+                if (record.left != 0)
+                    value = value.product(values[childIndex(record.left, i)].product(toComplex(record.leftWeight)));
+                if (record.right != 0)
+                    value = value.product(values[childIndex(record.right, i)].product(toComplex(record.rightWeight)));
+                values[i] = value;
+            }
+            return values[childIndex(header->head, n)].product(toComplex(header->headWeight));
+        }
+
+    // Private methods
+    private:
+        struct Weight {
+            int64_t real;
+            int64_t imaginary;
+        };
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t recordSize;
+            uint32_t padding;
+            int64_t modulus;
+            uint64_t numNodes;
+            uint64_t head;
+            Weight headWeight;
+        };
+
+        struct Record {
+            uint64_t left;
+            uint64_t right;
+            Weight leftWeight;
+            Weight rightWeight;
+        };
+
+        static const uint32_t MAGIC = 0x4d444454; // "TDDM"
+        static const uint32_t VERSION = 1;
+
+        static uint64_t writeEdge(IEdge* edge, std::unordered_map<INode*, uint64_t>& offsets, Weight& weight) {
+            weight = {0, 0};
+            if (edge == nullptr)
+                return 0;
+            weight = {edge->getValue().getRealPart(), edge->getValue().getImaginaryPart()};
+            return offsets.find(edge->getNode())->second;
+        }
+
+        static ComplexNumber toComplex(const Weight& weight) {
+            return ComplexNumber(weight.real, weight.imaginary);
+        }
+
+        // Index of the record at offset, which must come before record limit
+        std::size_t childIndex(uint64_t offset, std::size_t limit) {
+            uint64_t position = offset - sizeof(Header);
+            if (offset < sizeof(Header) || position % sizeof(Record) != 0 || position / sizeof(Record) >= limit)
+                throw std::runtime_error("MappedDD: corrupt child offset");
+            return position / sizeof(Record);
+        }
+
+        // Value of an edge of weight weight to node i, as Node::getProduct computes it
+        ComplexNumber edgeProduct(const Weight& weight, std::size_t i, std::vector<ComplexNumber>& first,
+                                  std::vector<ComplexNumber>& second) {
+            ComplexNumber value = toComplex(weight);
+            if (records[i].left != 0)
+                value = value.product(first[i]);
+            if (records[i].right != 0)
+                value = value.product(second[i]);
+            return value;
+        }
+
+    private:
+        void* base;
+        std::size_t size;
+        const Header* header;
+        const Record* records;
+};
+#endif
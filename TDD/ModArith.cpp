@@ -0,0 +1,51 @@
+#include <cstdint>
+
+#ifndef MOD_ARITH_H // include guard
+#define MOD_ARITH_H
+// Reduction by a compile-time modulus with a precomputed Barrett factor: one 64x64->128 bit
+// multiply, one 64 bit multiply and a conditional subtraction instead of a hardware division.
+// reduce(x) is bit-identical to x % MOD for every long x, including the sign of the result.
+// Selected for ComplexNumber with -DTDD_BARRETT_REDUCTION.
+template<long MOD>
+class BarrettReducer {
+    static_assert(MOD > 1, "The modulus must be greater than one");
+
+    public:
+        static long reduce(long x) {
+#ifdef __SIZEOF_INT128__
+            // C++ % truncates towards zero: reduce the magnitude and give it back the sign of x
+            uint64_t a = x < 0 ? -(uint64_t) x : (uint64_t) x;
+            // q is either floor(a / MOD) or one less
+            uint64_t q = (uint64_t) (((unsigned __int128) a * FACTOR) >> 64);
+            uint64_t r = a - q * (uint64_t) MOD;
+            if (r >= (uint64_t) MOD)
+                r -= MOD;
+            return x < 0 ? -(long) r : (long) r;
+#else
+            return x % MOD;
+#endif
+        }
+
+    private:
+#ifdef __SIZEOF_INT128__
+        static constexpr uint64_t FACTOR = (uint64_t) (((unsigned __int128) 1 << 64) / MOD);
+#endif
+};
+
+// Plain % by a constant. Unoptimized builds emit a hardware division for it, from -O1 on
+// GCC and Clang lower it to their own multiply-high sequence, which beats BarrettReducer.
+template<long MOD>
+class ModuloReducer {
+    public:
+        static long reduce(long x) {
+            return x % MOD;
+        }
+};
+
+// Reducer used by ComplexNumber
+#ifdef TDD_BARRETT_REDUCTION
+template<long MOD> using ModularReducer = BarrettReducer<MOD>;
+#else
+template<long MOD> using ModularReducer = ModuloReducer<MOD>;
+#endif
+#endif
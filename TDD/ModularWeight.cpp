@@ -0,0 +1,55 @@
+#include <string>
+
+using namespace std;
+
+#include "ModArith.cpp"
+
+#ifndef MODULAR_WEIGHT_H // include guard
+#define MODULAR_WEIGHT_H
+// Plain long weight modulo 2^31 - 1, the weight of the code/UELComputeDD.cpp prototype.
+// Same interface as ComplexNumber, so both instantiate TypedDD.
+class ModularWeight {
+    // Constructors
+    public:
+        ModularWeight() {
+            value = 1;
+        }
+
+        ModularWeight(long value) {
+            this->value = ModularReducer<MOD_NUMBER>::reduce(value);
+        }
+
+    // Methods
+    public:
+        long getValue() const {
+            return value;
+        }
+
+        string get_string() const {
+            return std::to_string(value);
+        }
+
+        ModularWeight product(const ModularWeight& other) const {
+            return ModularWeight(value * other.value);
+        }
+
+        static constexpr long getModulus() {
+            return MOD_NUMBER;
+        }
+
+    // Operators
+    public:
+        bool operator==(const ModularWeight& other) const {
+            return value == other.value;
+        }
+
+        bool operator!=(const ModularWeight& other) const {
+            return !(*this == other);
+        }
+
+    // Internal variables
+    private:
+        long value;
+        static constexpr long MOD_NUMBER = 2147483648 - 1;
+};
+#endif
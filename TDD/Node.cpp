@@ -1,8 +1,12 @@
+#include <atomic>
 #include <string>
+#include <algorithm>
 
 using namespace std;
 
 #include "Edge.cpp"
+#include "Arena.cpp"
+#include "TaskLoad.cpp"
 #include "Interfaces.cpp"
 #include "UniqueTable.cpp"
 #include "ComplexNumber.cpp"
@@ -12,17 +16,83 @@ using namespace std;
 class Node : public INode {
     // Constructors
     public:
-        Node(IEdge* leftEdge, IEdge* rightEdge) {
+        Node(IEdge* leftEdge, IEdge* rightEdge) : refCount(0) {
+            this->id = nextId();
             this->leftEdge = leftEdge;
             this->rightEdge = rightEdge;
+            this->level = 0;
+            if (leftEdge != nullptr) {
+                leftEdge->incRef();
+                level = std::max(level, leftEdge->getNode()->getLevel() + 1);
+            }
+            if (rightEdge != nullptr) {
+                rightEdge->incRef();
+                level = std::max(level, rightEdge->getNode()->getLevel() + 1);
+            }
         }
-        Node() {
+        Node() : refCount(0) {
+            this->id = nextId();
+            this->level = 0;
             this->leftEdge = nullptr;
             this->rightEdge = nullptr;
         }
+        ~Node() {
+            if (leftEdge != nullptr)
+                leftEdge->decRef();
+            if (rightEdge != nullptr)
+                rightEdge->decRef();
+        }
+    // Allocation
+    public:
+        static void* operator new(std::size_t size) {
+            return Arena::allocateCurrent(size);
+        }
+
+        static void operator delete(void* p, std::size_t size) {
+            Arena::deallocate(p, size);
+        }
+
     // Public methods
     public:
 
+        void incRef() {
+            refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // A node may still be found through the unique table, so a dead node is only
+        // freed by the garbage collection of that table
+        void decRef() {
+            refCount.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        int getRefCount() {
+            return refCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t getId() {
+            return id;
+        }
+
+        // Leaves are level 0, any other node sits one level above its highest child
+        int getLevel() {
+            return level;
+        }
+
+        NodeKey getKey() {
+            NodeKey key = {};
+            if (leftEdge != nullptr) {
+                key.leftId = leftEdge->getNode()->getId();
+                key.leftReal = leftEdge->getValue().getRealPart();
+                key.leftImaginary = leftEdge->getValue().getImaginaryPart();
+            }
+            if (rightEdge != nullptr) {
+                key.rightId = rightEdge->getNode()->getId();
+                key.rightReal = rightEdge->getValue().getRealPart();
+                key.rightImaginary = rightEdge->getValue().getImaginaryPart();
+            }
+            return key;
+        }
+
         IEdge* getLeftEdge() {
             return leftEdge;
         }
@@ -31,55 +101,95 @@ class Node : public INode {
             return rightEdge;
         }
 
-        IComplexNumber* getProduct(IComplexNumber* n) {
-            IComplexNumber* value = n;
+        ComplexNumber getProduct(ComplexNumber n) {
+            ComplexNumber value = n;
             if (leftEdge != nullptr)
-                value = value->product(leftEdge->getProduct());
+                value = value.product(leftEdge->getProduct());
             if (rightEdge != nullptr)
-                value = value->product(rightEdge->getProduct());
+                value = value.product(rightEdge->getProduct());
             // std::this_thread::sleep_for(std::chrono::milliseconds(10));
             return value;
         }
 
-        IComplexNumber* getProductParallel(IComplexNumber* n) {
-            IComplexNumber* leftValue = new ComplexNumber();
-            IComplexNumber* rightValue = new ComplexNumber();
-            #pragma omp parallel num_threads(2) shared(leftValue, rightValue)
-            {
-                #pragma omp single 
-                {
+        // Runs the two subtrees as tasks of the enclosing parallel region, see Runtime::run
+        ComplexNumber getProductParallel(ComplexNumber n) {
+            ComplexNumber leftValue = ComplexNumber();
+            ComplexNumber rightValue = ComplexNumber();
+            if (leftEdge != nullptr)
+                #pragma omp task shared(leftValue)
+                leftValue = leftEdge->getProduct();
+            if (rightEdge != nullptr)
+                #pragma omp task shared(rightValue)
+                rightValue = rightEdge->getProduct();
+            #pragma omp taskwait
+            return n.product(leftValue).product(rightValue);
+        }
+
+        // getProduct evaluating every distinct node once. A node with several parents keeps
+        // the values of its child edges in memo; they are multiplied in the order of getProduct.
+        ComplexNumber getProductMemoized(ComplexNumber n, ProductMemo* memo) {
+            ComplexNumber leftValue;
+            ComplexNumber rightValue;
+            bool shared = getRefCount() > 1;
+            if (!shared || !memo->lookup(this, leftValue, rightValue)) {
+                if (leftEdge != nullptr)
+                    leftValue = leftEdge->getProductMemoized(memo);
+                if (rightEdge != nullptr)
+                    rightValue = rightEdge->getProductMemoized(memo);
+                if (shared)
+                    memo->insert(this, leftValue, rightValue);
+            }
+            return n.product(leftValue).product(rightValue);
+        }
+
+        // Same with the left subtree as a task while the queue is short, see TaskLoad
+        ComplexNumber getProductMemoizedParallel(ComplexNumber n, ProductMemo* memo) {
+            ComplexNumber leftValue;
+            ComplexNumber rightValue;
+            bool shared = getRefCount() > 1;
+            if (!shared || !memo->lookup(this, leftValue, rightValue)) {
+                if (leftEdge != nullptr && rightEdge != nullptr && TaskLoad::shouldSplit()) {
+                    TaskLoad::queued();
+                    #pragma omp task shared(leftValue)
+                    {
+                        TaskLoad::started();
+                        leftValue = leftEdge->getProductMemoizedParallel(memo);
+                    }
+                    rightValue = rightEdge->getProductMemoizedParallel(memo);
+                    #pragma omp taskwait
+                } else {
                     if (leftEdge != nullptr)
-                        #pragma omp task
-                        leftValue = leftEdge->getProduct();
+                        leftValue = leftEdge->getProductMemoizedParallel(memo);
                     if (rightEdge != nullptr)
-                        #pragma omp task
-                        rightValue = rightEdge->getProduct();
+                        rightValue = rightEdge->getProductMemoizedParallel(memo);
                 }
+                if (shared)
+                    memo->insert(this, leftValue, rightValue);
             }
-            return n->product(leftValue)->product(rightValue);
+            return n.product(leftValue).product(rightValue);
         }
 
-        IEdge* getDDProduct(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct) {
-            IComplexNumber* value = n;
+        IEdge* getDDProduct(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct) {
+            ComplexNumber value = n;
             IEdge* leftEdge = nullptr;
             IEdge* rightEdge = nullptr;
             if (this->leftEdge != nullptr) {
                 leftEdge  = this->leftEdge->getDDProduct(ut, ct);
-                value = value->product(leftEdge->getValue());
+                value = value.product(leftEdge->getValue());
             }
             if (this->rightEdge != nullptr) {
                 rightEdge = this->rightEdge->getDDProduct(ut, ct);
-                value = value->product(rightEdge->getValue());
+                value = value.product(rightEdge->getValue());
             }
             // std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            auto node = ut->lookup(new Node(leftEdge, rightEdge));
+            auto node = lookupUnique(ut, leftEdge, rightEdge);
             return new Edge(value, node);
         }
 
-        IEdge* getDDProductParallel(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) {
-            IComplexNumber* value = n;
-            IComplexNumber* leftValue = new ComplexNumber();
-            IComplexNumber* rightValue = new ComplexNumber();
+        IEdge* getDDProductParallel(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) {
+            ComplexNumber value = n;
+            ComplexNumber leftValue = ComplexNumber();
+            ComplexNumber rightValue = ComplexNumber();
             IEdge* leftEdge = nullptr;
             IEdge* rightEdge = nullptr;
             if (level == 0)
@@ -100,16 +210,16 @@ class Node : public INode {
             }
             #pragma omp taskwait
             #pragma omp flush
-            value = value->product(leftValue);
-            value = value->product(rightValue);
-            auto node = ut->lookup(new Node(leftEdge, rightEdge));
+            value = value.product(leftValue);
+            value = value.product(rightValue);
+            auto node = lookupUnique(ut, leftEdge, rightEdge);
             return new Edge(value, node);
         }
 
-        IEdge* getDDProductParallelCached(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) {
-            IComplexNumber* value = n;
-            IComplexNumber* leftValue = new ComplexNumber();
-            IComplexNumber* rightValue = new ComplexNumber();
+        IEdge* getDDProductParallelCached(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) {
+            ComplexNumber value = n;
+            ComplexNumber leftValue = ComplexNumber();
+            ComplexNumber rightValue = ComplexNumber();
             IEdge* leftEdge = nullptr;
             IEdge* rightEdge = nullptr;
             if (level == 0)
@@ -130,19 +240,19 @@ class Node : public INode {
                 }
             }
             #pragma omp taskwait
-            value = n->product(leftValue)->product(rightValue);
-            auto node = ut->lookup(new Node(leftEdge, rightEdge));
+            value = n.product(leftValue).product(rightValue);
+            auto node = lookupUnique(ut, leftEdge, rightEdge);
             return new Edge(value, node);
         }
 
-        IEdge* getDDProductParallelPrivate(IComplexNumber* n, IUniqueTable* ut, IComputeTable* ct, int level) {
-            IComplexNumber* value = n;
-            IComplexNumber* leftValue = new ComplexNumber();
-            IComplexNumber* rightValue = new ComplexNumber();
+        IEdge* getDDProductParallelPrivate(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct, int level) {
+            ComplexNumber value = n;
+            ComplexNumber leftValue = ComplexNumber();
+            ComplexNumber rightValue = ComplexNumber();
             IEdge* leftEdge = nullptr;
             IEdge* rightEdge = nullptr;
             if (level == 0)
-                return this->getDDProduct(n, new UniqueTablePrivate(), ct);
+                return this->getDDProduct(n, createPrivateTable(ut), ct);
             #pragma omp task shared(leftValue, rightValue, leftEdge, rightEdge, level)
             {
                 if (this->leftEdge != nullptr) {
@@ -158,8 +268,38 @@ class Node : public INode {
                 }
             }
             #pragma omp taskwait
-            value = n->product(leftValue)->product(rightValue);
-            auto node = ut->lookup(new Node(leftEdge, rightEdge));
+            value = n.product(leftValue).product(rightValue);
+            auto node = lookupUnique(ut, leftEdge, rightEdge);
+            return new Edge(value, node);
+        }
+
+        // Splits into a task only while TaskLoad reports spare threads, no level to tune.
+        // The left child goes to the task pool, where any idle thread can steal it, and the
+        // right one is evaluated by the current thread in the meantime.
+        IEdge* getDDProductParallelAdaptive(ComplexNumber n, IUniqueTable* ut, IComputeTable* ct) {
+            ComplexNumber value = n;
+            IEdge* leftEdge = nullptr;
+            IEdge* rightEdge = nullptr;
+            if (this->leftEdge != nullptr && this->rightEdge != nullptr && TaskLoad::shouldSplit()) {
+                TaskLoad::queued();
+                #pragma omp task shared(leftEdge)
+                {
+                    TaskLoad::started();
+                    leftEdge = this->leftEdge->getDDProductParallelAdaptive(ut, ct);
+                }
+                rightEdge = this->rightEdge->getDDProductParallelAdaptive(ut, ct);
+                #pragma omp taskwait
+            } else {
+                if (this->leftEdge != nullptr)
+                    leftEdge = this->leftEdge->getDDProductParallelAdaptive(ut, ct);
+                if (this->rightEdge != nullptr)
+                    rightEdge = this->rightEdge->getDDProductParallelAdaptive(ut, ct);
+            }
+            if (leftEdge != nullptr)
+                value = value.product(leftEdge->getValue());
+            if (rightEdge != nullptr)
+                value = value.product(rightEdge->getValue());
+            auto node = lookupUnique(ut, leftEdge, rightEdge);
             return new Edge(value, node);
         }
 
@@ -167,16 +307,88 @@ class Node : public INode {
             if (leftEdge == nullptr && rightEdge == nullptr)
                 return string_format("%i", nullptr);
             else
-                return string_format("%i",  leftEdge->getNode()) + leftEdge->getValue()->get_string()
-                     + string_format("%i", rightEdge->getNode()) + rightEdge->getValue()->get_string();
+                return string_format("%i",  leftEdge->getNode()) + leftEdge->getValue().get_string()
+                     + string_format("%i", rightEdge->getNode()) + rightEdge->getValue().get_string();
             /*
                 return  string_format("%i%s%i%s", 
-                                        leftEdge->getNode(), leftEdge->getValue()->get_string(), 
-                                        rightEdge->getNode(), rightEdge->getValue()->get_string());
+                                        leftEdge->getNode(), leftEdge->getValue().get_string(), 
+                                        rightEdge->getNode(), rightEdge->getValue().get_string());
             */
         }
 
+        // Hash-conses the node with the given children, dropping the candidate if an equal node
+        // exists. Every product goes through here, IterativeEvaluator included.
+        static INode* lookupUnique(IUniqueTable* ut, IEdge* leftEdge, IEdge* rightEdge) {
+            return lookupCandidate(ut, createCandidate(ut, leftEdge, rightEdge));
+        }
+
+        // The two halves of lookupUnique, for callers that build the candidates of a whole
+        // level before hash-consing them, see DD::getDDProductLevelParallel
+        static Node* createCandidate(IUniqueTable* ut, IEdge* leftEdge, IEdge* rightEdge) {
+            if (ut->isNormalized())
+                normalizeWeights(leftEdge, rightEdge);
+            return new Node(leftEdge, rightEdge);
+        }
+
+        static INode* lookupCandidate(IUniqueTable* ut, Node* candidate) {
+            INode* node = ut->lookup(candidate);
+            if (node != candidate)
+                delete candidate;
+            return node;
+        }
+
+    // Private methods
+    private:
+        // Moves a scalar from one child weight to the other: the left weight is divided by
+        // itself and the right one multiplied by it, or the other way round when only the right
+        // one is invertible. The value of an edge multiplies the weights of both children, so
+        // only their product counts: the node keeps its products, and so do the diagrams the
+        // DD products build from it, while nodes whose weights differ by such a scalar end up
+        // under the same node. A node with one child has nothing to move.
+        static void normalizeWeights(IEdge*& leftEdge, IEdge*& rightEdge) {
+            ComplexNumber leftFactor = ComplexNumber();
+            ComplexNumber rightFactor = ComplexNumber();
+            ComplexNumber inverse;
+            if (leftEdge != nullptr && rightEdge != nullptr) {
+                if (leftEdge->getValue().inverse(inverse)) {
+                    leftFactor = inverse;
+                    rightFactor = leftEdge->getValue();
+                } else if (rightEdge->getValue().inverse(inverse)) {
+                    leftFactor = rightEdge->getValue();
+                    rightFactor = inverse;
+                }
+            }
+            leftEdge = rescale(leftEdge, leftFactor);
+            rightEdge = rescale(rightEdge, rightFactor);
+        }
+
+        // Replaces a fresh, unreferenced edge by one with its weight times factor
+        static IEdge* rescale(IEdge* edge, ComplexNumber factor) {
+            if (edge == nullptr)
+                return nullptr;
+            IEdge* scaled = new Edge(edge->getValue().product(factor).canonical(), edge->getNode());
+            edge->incRef();
+            edge->decRef();
+            return scaled;
+        }
+
+        // Private tables of the parallel product follow the mode of the shared one
+        static IUniqueTable* createPrivateTable(IUniqueTable* ut) {
+            IUniqueTable* table = new UniqueTablePrivate();
+            table->setNormalized(ut->isNormalized());
+            return table;
+        }
+
+        // Ids start at 1, 0 is reserved for a missing child in NodeKey
+        static uint64_t nextId() {
+            static std::atomic<uint64_t> counter(1);
+            return counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
     private:
+        uint64_t id;
+        int level;
+        std::atomic<int> refCount;
         IEdge *leftEdge;
         IEdge *rightEdge;
         // static const int MOD_NUMBER = pow(2, 30) - 1;
@@ -0,0 +1,45 @@
+#include <cstdint>
+#include <cstddef>
+
+#ifndef NODE_KEY_H // include guard
+#define NODE_KEY_H
+// Fixed-size structural key of a node: (child id, weight real, weight imaginary) for
+// both children. Missing children are encoded as id 0 with a zero weight.
+struct NodeKey {
+    uint64_t leftId;
+    long leftReal;
+    long leftImaginary;
+    uint64_t rightId;
+    long rightReal;
+    long rightImaginary;
+
+    bool operator==(const NodeKey& other) const {
+        return leftId == other.leftId && leftReal == other.leftReal && leftImaginary == other.leftImaginary
+            && rightId == other.rightId && rightReal == other.rightReal && rightImaginary == other.rightImaginary;
+    }
+
+    bool operator!=(const NodeKey& other) const {
+        return !(*this == other);
+    }
+};
+
+struct NodeKeyHash {
+    std::size_t operator()(const NodeKey& key) const {
+        uint64_t h = mix(key.leftId);
+        h = mix(h ^ (uint64_t) key.leftReal);
+        h = mix(h ^ (uint64_t) key.leftImaginary);
+        h = mix(h ^ key.rightId);
+        h = mix(h ^ (uint64_t) key.rightReal);
+        h = mix(h ^ (uint64_t) key.rightImaginary);
+        return (std::size_t) h;
+    }
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+#endif
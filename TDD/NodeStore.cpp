@@ -0,0 +1,383 @@
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+
+#include "Interfaces.cpp"
+#include "BatchProduct.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef NODE_STORE_H // include guard
+#define NODE_STORE_H
+// Structure-of-arrays copy of a DD. Nodes are grouped by level (leaves are level 0, a node
+// sits one level above its highest child) and named by a flat 32 bit id: the levels are
+// numbered one after the other, so node i of level l is getLevelOffset(l) + i. Each level
+// keeps its child ids and child weights in four parallel arrays. Leaves have no children,
+// so level 0 is only a count. The ids also index the flat value arrays of the evaluators.
+//
+// The evaluators walk the levels bottom-up, gather the values of the children and combine
+// them with BatchProduct, which keeps the multiplication order of the recursive evaluators:
+// results are bit-identical to Edge::getProduct and DD::getDDProduct.
+class NodeStore {
+    // Constructors
+    public:
+        // Copies the diagram under edge. Nodes shared in the source are shared in the store.
+        NodeStore(IEdge* edge) {
+            headWeight = edge->getValue();
+            importDiagram(edge->getNode());
+        }
+
+    // Methods
+    public:
+        static const uint32_t NO_NODE = 0xffffffff;
+
+        int getLevel(uint32_t id) {
+            return std::upper_bound(offsets.begin(), offsets.end(), id) - offsets.begin() - 1;
+        }
+
+        uint32_t getIndex(uint32_t id) {
+            return id - offsets[getLevel(id)];
+        }
+
+        // Id of the first node of level
+        uint32_t getLevelOffset(int level) {
+            return offsets[level];
+        }
+
+        int getNumLevels() {
+            return levels.size() + 1;
+        }
+
+        std::size_t getNodeCount(int level) {
+            return level == 0 ? numLeaves : levels[level - 1].left.size();
+        }
+
+        std::size_t getNodeCount() {
+            return offsets.back();
+        }
+
+        uint32_t getHeadNode() {
+            return headNode;
+        }
+
+        ComplexNumber getHeadWeight() {
+            return headWeight;
+        }
+
+        // Weight of the left or right edge of node id, one for a missing child
+        ComplexNumber getWeight(uint32_t id, bool right) {
+            Level& level = getNodeLevel(id);
+            uint32_t index = id - offsets[getLevel(id)];
+            return right ? level.rightWeight[index] : level.leftWeight[index];
+        }
+
+        // Bytes held by the node arrays
+        std::size_t getMemoryBytes() {
+            std::size_t bytes = sizeof(NodeStore) + levels.capacity() * sizeof(Level) + offsets.capacity() * sizeof(uint32_t);
+            for (Level& level : levels) {
+                bytes += (level.left.capacity() + level.right.capacity()) * sizeof(uint32_t);
+                bytes += (level.leftWeight.capacity() + level.rightWeight.capacity()) * sizeof(ComplexNumber);
+            }
+            return bytes;
+        }
+
+        // Product of the weights of every root-to-leaf path edge, as Edge::getProduct. The value
+        // of an edge (w, node) is (w * first(node)) * second(node), where first and second are
+        // the values of the child edges of node, so each level computes that pair per node.
+        ComplexNumber getProduct() {
+            std::vector<ComplexNumber> first(getNodeCount(), ComplexNumber());
+            std::vector<ComplexNumber> second(getNodeCount(), ComplexNumber());
+            std::vector<ComplexNumber> childFirst;
+            std::vector<ComplexNumber> childSecond;
+            for (int l = 1; l < getNumLevels(); l++) {
+                Level& level = levels[l - 1];
+                std::size_t n = level.left.size();
+                ComplexNumber* levelFirst = first.data() + offsets[l];
+                ComplexNumber* levelSecond = second.data() + offsets[l];
+                gather(level.left, first, childFirst);
+                gather(level.left, second, childSecond);
+                BatchProduct::multiply(level.leftWeight.data(), childFirst.data(), levelFirst, n);
+                BatchProduct::multiply(levelFirst, childSecond.data(), levelFirst, n);
+                gather(level.right, first, childFirst);
+                gather(level.right, second, childSecond);
+                BatchProduct::multiply(level.rightWeight.data(), childFirst.data(), levelSecond, n);
+                BatchProduct::multiply(levelSecond, childSecond.data(), levelSecond, n);
+            }
+            return headWeight.product(first[headNode]).product(second[headNode]);
+        }
+
+        // Same as DD::getDDProduct: every child weight becomes the product of the subdiagram
+        // below it, computed in place, and the new head weight is returned. Nodes are not
+        // merged, the result keeps the shape of the input.
+        ComplexNumber getDDProduct() {
+            // values[id] is the product of the subdiagram below node id
+            std::vector<ComplexNumber> values(getNodeCount(), ComplexNumber());
+            std::vector<ComplexNumber> children;
+            for (int l = 1; l < getNumLevels(); l++) {
+                Level& level = levels[l - 1];
+                std::size_t n = level.left.size();
+                gather(level.left, values, children);
+                BatchProduct::multiply(children.data(), level.leftWeight.data(), level.leftWeight.data(), n);
+                gather(level.right, values, children);
+                BatchProduct::multiply(children.data(), level.rightWeight.data(), level.rightWeight.data(), n);
+                BatchProduct::multiply(level.leftWeight.data(), level.rightWeight.data(), values.data() + offsets[l], n);
+            }
+            headWeight = values[headNode].product(headWeight);
+            return headWeight;
+        }
+
+        // K sets of edge weights for the structure of a store, stored lane-wise: the K weights
+        // of one edge are contiguous, so the products of a level run over n * K elements and
+        // vectorise across the sets. left[l - 1][i * lanes + k] is the weight of the left edge
+        // of node i of level l in set k, right likewise, head[k] the head weight. The child
+        // ids, leaf count and head node of the store that created them are kept alongside, so
+        // weights are only taken from and evaluated on stores of that structure.
+        struct Valuations {
+            std::size_t lanes;
+            std::vector<std::vector<ComplexNumber>> left;
+            std::vector<std::vector<ComplexNumber>> right;
+            std::vector<ComplexNumber> head;
+            std::vector<std::vector<uint32_t>> leftIds;
+            std::vector<std::vector<uint32_t>> rightIds;
+            std::size_t numLeaves;
+            uint32_t headNode;
+        };
+
+        // Every lane starts with the weights of the store
+        Valuations createValuations(std::size_t lanes) {
+            Valuations valuations;
+            valuations.lanes = lanes;
+            valuations.left.resize(levels.size());
+            valuations.right.resize(levels.size());
+            valuations.leftIds.resize(levels.size());
+            valuations.rightIds.resize(levels.size());
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                valuations.left[l].resize(levels[l].left.size() * lanes);
+                valuations.right[l].resize(levels[l].left.size() * lanes);
+                valuations.leftIds[l] = levels[l].left;
+                valuations.rightIds[l] = levels[l].right;
+            }
+            valuations.head.resize(lanes);
+            valuations.numLeaves = numLeaves;
+            valuations.headNode = headNode;
+            for (std::size_t lane = 0; lane < lanes; lane++)
+                setLane(valuations, lane);
+            return valuations;
+        }
+
+        // Copies the weights of the store into one lane. valuations may come from another
+        // store of the same structure, for example a copy of a DD built with other weights.
+        void setLane(Valuations& valuations, std::size_t lane) {
+            if (lane >= valuations.lanes)
+                throw std::invalid_argument("NodeStore: no such lane");
+            checkStructure(valuations);
+            std::size_t lanes = valuations.lanes;
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                Level& level = levels[l];
+                for (std::size_t i = 0; i < level.left.size(); i++) {
+                    valuations.left[l][i * lanes + lane] = level.leftWeight[i];
+                    valuations.right[l][i * lanes + lane] = level.rightWeight[i];
+                }
+            }
+            valuations.head[lane] = headWeight;
+        }
+
+        // Fills one lane without a DD or a store for its weights: weight(id, right) is the
+        // weight of the left or right edge of node id, see getWeight, and head the head
+        // weight. Missing children keep weight one.
+        void setLane(Valuations& valuations, std::size_t lane, std::function<ComplexNumber(uint32_t, bool)> weight,
+                     ComplexNumber head) {
+            if (lane >= valuations.lanes)
+                throw std::invalid_argument("NodeStore: no such lane");
+            checkStructure(valuations);
+            std::size_t lanes = valuations.lanes;
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                Level& level = levels[l];
+                for (std::size_t i = 0; i < level.left.size(); i++) {
+                    uint32_t id = offsets[l + 1] + i;
+                    valuations.left[l][i * lanes + lane] = level.left[i] == NO_NODE ? ComplexNumber() : weight(id, false);
+                    valuations.right[l][i * lanes + lane] = level.right[i] == NO_NODE ? ComplexNumber() : weight(id, true);
+                }
+            }
+            valuations.head[lane] = head;
+        }
+
+        // getDDProduct for every set of weights in one bottom-up pass, which walks the
+        // structure once for all of them. Neither the store nor the valuations change. The
+        // working arrays, K times those of getDDProduct, are kept for the next call, so a
+        // store must not evaluate valuations from several threads at once.
+        std::vector<ComplexNumber> getDDProducts(const Valuations& valuations) {
+            checkStructure(valuations);
+            std::size_t lanes = valuations.lanes;
+            // values[id * lanes + k] is the product below node id in set k
+            std::vector<ComplexNumber>& values = laneValues;
+            values.assign(getNodeCount() * lanes, ComplexNumber());
+            // The value of a missing child in every lane
+            std::vector<ComplexNumber> ones(lanes, ComplexNumber());
+            std::vector<ComplexNumber>& leftValues = laneLeft;
+            std::vector<ComplexNumber>& rightValues = laneRight;
+            for (int l = 1; l < getNumLevels(); l++) {
+                Level& level = levels[l - 1];
+                std::size_t n = level.left.size() * lanes;
+                leftValues.resize(n);
+                rightValues.resize(n);
+                multiplyLanes(level.left, values, valuations.left[l - 1], lanes, ones, leftValues);
+                multiplyLanes(level.right, values, valuations.right[l - 1], lanes, ones, rightValues);
+                BatchProduct::multiply(leftValues.data(), rightValues.data(), values.data() + offsets[l] * lanes, n);
+            }
+            const ComplexNumber* head = values.data() + (std::size_t) headNode * lanes;
+            std::vector<ComplexNumber> result(lanes);
+            BatchProduct::multiply(head, valuations.head.data(), result.data(), lanes);
+            return result;
+        }
+
+    // Private methods
+    private:
+        struct Level {
+            std::vector<uint32_t> left;
+            std::vector<uint32_t> right;
+            std::vector<ComplexNumber> leftWeight;
+            std::vector<ComplexNumber> rightWeight;
+        };
+
+        // Copies the diagram below root in post-order, children first, with an explicit stack
+        // as in IterativeEvaluator so that deep diagrams do not overflow the call stack.
+        // Node::getLevel puts a node above both of its children. Children are first named
+        // by level and index, and given their flat ids once every level size is known.
+        void importDiagram(INode* root) {
+            numLeaves = 0;
+            std::unordered_map<INode*, uint64_t> imported;
+            std::vector<std::vector<uint64_t>> leftChildren;
+            std::vector<std::vector<uint64_t>> rightChildren;
+            std::vector<INode*> stack;
+            stack.push_back(root);
+            while (!stack.empty()) {
+                INode* node = stack.back();
+                if (imported.count(node) != 0) {
+                    stack.pop_back();
+                    continue;
+                }
+                INode* left = node->getLeftEdge() != nullptr ? node->getLeftEdge()->getNode() : nullptr;
+                INode* right = node->getRightEdge() != nullptr ? node->getRightEdge()->getNode() : nullptr;
+                // The left subtree goes on top, so it is copied before the right one
+                bool ready = true;
+                if (right != nullptr && imported.count(right) == 0) {
+                    stack.push_back(right);
+                    ready = false;
+                }
+                if (left != nullptr && imported.count(left) == 0) {
+                    stack.push_back(left);
+                    ready = false;
+                }
+                if (!ready)
+                    continue;
+                stack.pop_back();
+                uint64_t name;
+                if (left == nullptr && right == nullptr) {
+                    name = makeName(0, numLeaves++);
+                } else {
+                    int l = node->getLevel();
+                    if ((std::size_t) l > levels.size()) {
+                        levels.resize(l);
+                        leftChildren.resize(l);
+                        rightChildren.resize(l);
+                    }
+                    Level& level = levels[l - 1];
+                    name = makeName(l, level.leftWeight.size());
+                    leftChildren[l - 1].push_back(left != nullptr ? imported[left] : NO_NAME);
+                    rightChildren[l - 1].push_back(right != nullptr ? imported[right] : NO_NAME);
+                    level.leftWeight.push_back(left != nullptr ? node->getLeftEdge()->getValue() : ComplexNumber());
+                    level.rightWeight.push_back(right != nullptr ? node->getRightEdge()->getValue() : ComplexNumber());
+                }
+                imported.emplace(node, name);
+            }
+            if (numLeaves >= NO_NODE)
+                throw std::length_error("NodeStore: too many nodes");
+            offsets.assign(levels.size() + 2, 0);
+            offsets[1] = numLeaves;
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                if (offsets[l + 1] + levels[l].leftWeight.size() >= NO_NODE)
+                    throw std::length_error("NodeStore: too many nodes");
+                offsets[l + 2] = offsets[l + 1] + levels[l].leftWeight.size();
+            }
+            for (std::size_t l = 0; l < levels.size(); l++) {
+                levels[l].left = toIds(leftChildren[l]);
+                levels[l].right = toIds(rightChildren[l]);
+            }
+            headNode = toId(imported[root]);
+        }
+
+        // Level in the high 32 bits, index inside the level in the low ones
+        static uint64_t makeName(int level, std::size_t index) {
+            return ((uint64_t) level << 32) | index;
+        }
+
+        uint32_t toId(uint64_t name) {
+            return name == NO_NAME ? NO_NODE : offsets[name >> 32] + (uint32_t) name;
+        }
+
+        std::vector<uint32_t> toIds(const std::vector<uint64_t>& names) {
+            std::vector<uint32_t> ids(names.size());
+            for (std::size_t i = 0; i < names.size(); i++)
+                ids[i] = toId(names[i]);
+            return ids;
+        }
+
+        Level& getNodeLevel(uint32_t id) {
+            if (id < numLeaves || id >= getNodeCount())
+                throw std::out_of_range("NodeStore: no inner node with this id");
+            return levels[getLevel(id) - 1];
+        }
+
+        // valuations must come from a store with the same child ids on every level, the same
+        // leaves and the same head node
+        void checkStructure(const Valuations& valuations) {
+            bool same = valuations.numLeaves == numLeaves && valuations.headNode == headNode
+                && valuations.leftIds.size() == levels.size();
+            for (std::size_t l = 0; same && l < levels.size(); l++)
+                same = valuations.leftIds[l] == levels[l].left && valuations.rightIds[l] == levels[l].right;
+            if (!same)
+                throw std::invalid_argument("NodeStore: valuations of another structure");
+        }
+
+        // out[i] = value of the node ids[i]. A missing child has weight one and gathers one,
+        // and multiplying by one is exact, so it drops out of the products.
+        static void gather(const std::vector<uint32_t>& ids, const std::vector<ComplexNumber>& values,
+                           std::vector<ComplexNumber>& out) {
+            out.resize(ids.size());
+            for (std::size_t i = 0; i < ids.size(); i++) {
+                uint32_t id = ids[i];
+                out[i] = id == NO_NODE ? ComplexNumber() : values[id];
+            }
+        }
+
+        // out[i * lanes + k] = value of the node ids[i] times weights[i * lanes + k]: the
+        // lanes of one node are contiguous, so each node is one short vectorised product
+        static void multiplyLanes(const std::vector<uint32_t>& ids, const std::vector<ComplexNumber>& values,
+                                  const std::vector<ComplexNumber>& weights, std::size_t lanes,
+                                  const std::vector<ComplexNumber>& ones, std::vector<ComplexNumber>& out) {
+            for (std::size_t i = 0; i < ids.size(); i++) {
+                uint32_t id = ids[i];
+                const ComplexNumber* child = id == NO_NODE ? ones.data() : values.data() + (std::size_t) id * lanes;
+                BatchProduct::multiply(child, weights.data() + i * lanes, out.data() + i * lanes, lanes);
+            }
+        }
+
+    private:
+        static constexpr uint64_t NO_NAME = ~(uint64_t) 0;
+
+        std::vector<Level> levels;
+        // offsets[l] is the id of the first node of level l, the last entry the node count
+        std::vector<uint32_t> offsets;
+        // Working arrays of getDDProducts
+        std::vector<ComplexNumber> laneValues;
+        std::vector<ComplexNumber> laneLeft;
+        std::vector<ComplexNumber> laneRight;
+        std::size_t numLeaves;
+        ComplexNumber headWeight;
+        uint32_t headNode;
+};
+#endif
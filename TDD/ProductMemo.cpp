@@ -0,0 +1,94 @@
+#include <omp.h>
+#include <cstdint>
+#include <unordered_map>
+
+#include "NodeKey.cpp"
+#include "Interfaces.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef PRODUCT_MEMO_H // include guard
+#define PRODUCT_MEMO_H
+// Values computed during one memoised getProduct call, for the nodes and edges that have
+// several parents: the child edge values of a node, the value of an edge. Anything else is
+// reached once per visit of its only parent and is not stored. Lock-striped like
+// ConcurrentUniqueTable, the parallel evaluation shares one memo between its tasks.
+class ProductMemo {
+    // Constructors
+    public:
+        // numShards is rounded up to a power of two
+        ProductMemo(int numShards = 64) {
+            this->numShards = 1;
+            while (this->numShards < numShards)
+                this->numShards *= 2;
+            shards = new Shard[this->numShards];
+            for (int i = 0; i < this->numShards; i++)
+                omp_init_lock(&shards[i].lock);
+        }
+
+        ~ProductMemo() {
+            for (int i = 0; i < numShards; i++)
+                omp_destroy_lock(&shards[i].lock);
+            delete[] shards;
+        }
+    // Methods
+    public:
+        bool lookup(INode* node, ComplexNumber& left, ComplexNumber& right) {
+            Shard& shard = getShard(node);
+            omp_set_lock(&shard.lock);
+            auto it = shard.nodes.find(node);
+            bool found = it != shard.nodes.end();
+            if (found) {
+                left = it->second.left;
+                right = it->second.right;
+            }
+            omp_unset_lock(&shard.lock);
+            return found;
+        }
+
+        bool lookup(IEdge* edge, ComplexNumber& value) {
+            Shard& shard = getShard(edge);
+            omp_set_lock(&shard.lock);
+            auto it = shard.edges.find(edge);
+            bool found = it != shard.edges.end();
+            if (found)
+                value = it->second;
+            omp_unset_lock(&shard.lock);
+            return found;
+        }
+
+        // Two tasks may evaluate the same node or edge at once, they store the same values
+        void insert(INode* node, ComplexNumber left, ComplexNumber right) {
+            Shard& shard = getShard(node);
+            omp_set_lock(&shard.lock);
+            shard.nodes.emplace(node, Entry{left, right});
+            omp_unset_lock(&shard.lock);
+        }
+
+        void insert(IEdge* edge, ComplexNumber value) {
+            Shard& shard = getShard(edge);
+            omp_set_lock(&shard.lock);
+            shard.edges.emplace(edge, value);
+            omp_unset_lock(&shard.lock);
+        }
+
+    private:
+        struct Entry {
+            ComplexNumber left;
+            ComplexNumber right;
+        };
+
+        struct alignas(64) Shard {
+            omp_lock_t lock;
+            std::unordered_map<INode*, Entry> nodes;
+            std::unordered_map<IEdge*, ComplexNumber> edges;
+        };
+
+        Shard& getShard(const void* key) {
+            return shards[(NodeKeyHash::mix((uint64_t) (uintptr_t) key) >> 32) & (numShards - 1)];
+        }
+
+    private:
+        Shard* shards;
+        int numShards;
+};
+#endif
@@ -0,0 +1,84 @@
+#include <omp.h>
+#include <cstddef>
+#include <cstdlib>
+
+#include "Arena.cpp"
+#include "TaskLoad.cpp"
+
+#ifndef RUNTIME_H // include guard
+#define RUNTIME_H
+// Execution context shared by the parallel entry points of DD. It fixes the number of threads
+// once, from the API or the TDD_NUM_THREADS environment variable, and runs every parallel
+// product on a team of exactly that size. OpenMP keeps the threads of a team alive between
+// regions of the same size, so repeated calls reuse one pool instead of rebuilding it, and
+// nested regions are never opened.
+class Runtime {
+    // Constructors
+    public:
+        Runtime() {
+            setNumThreads(threadsFromEnvironment());
+        }
+
+        Runtime(int numThreads) {
+            setNumThreads(numThreads);
+        }
+
+    // Methods
+    public:
+        int getNumThreads() {
+            return numThreads;
+        }
+
+        void setNumThreads(int numThreads) {
+            this->numThreads = numThreads > 0 ? numThreads : omp_get_max_threads();
+        }
+
+        // Runs f once on the pool. Every thread of the team allocates from arena while f and
+        // the tasks it spawns are running, and counts the queued tasks of this run only.
+        template<typename F>
+        void run(Arena* arena, F f) {
+            TaskLoad load;
+            #pragma omp parallel num_threads(numThreads)
+            {
+                Arena::Scope scope(arena);
+                TaskLoad::Scope loadScope(&load);
+                #pragma omp single
+                {
+                    f();
+                }
+            }
+        }
+
+        // Runs f(i) for every i below n on the pool, in one contiguous chunk per thread.
+        // Every thread allocates from arena meanwhile.
+        template<typename F>
+        void forEach(Arena* arena, std::size_t n, F f) {
+            #pragma omp parallel num_threads(numThreads)
+            {
+                Arena::Scope scope(arena);
+                #pragma omp for schedule(static)
+                for (std::size_t i = 0; i < n; i++)
+                    f(i);
+            }
+        }
+
+    // Static methods
+    public:
+        static Runtime* getDefault() {
+            static Runtime runtime;
+            return &runtime;
+        }
+
+    // Private methods
+    private:
+        static int threadsFromEnvironment() {
+            const char* value = std::getenv("TDD_NUM_THREADS");
+            if (value == nullptr)
+                return 0;
+            return std::atoi(value);
+        }
+
+    private:
+        int numThreads;
+};
+#endif
@@ -0,0 +1,270 @@
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "DD.cpp"
+#include "Edge.cpp"
+#include "Node.cpp"
+#include "Arena.cpp"
+#include "NodeKey.cpp"
+#include "Interfaces.cpp"
+#include "ComplexNumber.cpp"
+
+#ifndef SNAPSHOT_H // include guard
+#define SNAPSHOT_H
+// Binary image of a DD for warm starts: the nodes reachable from the head edge or held by
+// the unique or compute table, the head edge and the entries of both tables.
+//
+// Nodes are named by stable ids, their position in the snapshot plus one (0 is a missing
+// child, as in NodeKey), and stored children first, so the loader builds every node after
+// its children in a single pass. Each node record carries its two child edges inline; edges
+// shared between nodes in memory are separate after a reload. Compute table keys name their
+// children by the same ids, entries whose children are not in the snapshot can never match
+// again and are dropped.
+//
+// Records are written in the byte order of the machine, the header rejects a snapshot of a
+// build with another modulus or another layout.
+class Snapshot {
+    // Methods
+    public:
+        static void save(DD* dd, std::ostream& out) {
+            IUniqueTable* ut = dd->getUniqueTable();
+            IComputeTable* ct = dd->getComputeTable();
+            std::vector<INode*> roots = {dd->getHeadEdge()->getNode()};
+            std::unordered_set<INode*> inUniqueTable;
+            ut->forEach([&](INode* node) {
+                roots.push_back(node);
+                inUniqueTable.insert(node);
+            });
+            ct->forEach([&](const NodeKey&, IEdge* edge) {
+                roots.push_back(edge->getNode());
+            });
+            std::vector<INode*> nodes = collectNodes(roots);
+            if (nodes.size() >= UINT32_MAX)
+                throw std::length_error("Snapshot: too many nodes");
+
+            // Runtime ids of the nodes to stable ids
+            std::unordered_map<uint64_t, uint32_t> ids;
+            std::unordered_map<INode*, uint32_t> positions;
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                ids.emplace(nodes[i]->getId(), i + 1);
+                positions.emplace(nodes[i], i + 1);
+            }
+
+            std::vector<NodeRecord> nodeRecords(nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                NodeRecord& record = nodeRecords[i];
+                record.left = writeEdge(nodes[i]->getLeftEdge(), positions, record.leftWeight);
+                record.right = writeEdge(nodes[i]->getRightEdge(), positions, record.rightWeight);
+                record.flags = inUniqueTable.count(nodes[i]) ? IN_UNIQUE_TABLE : 0;
+            }
+
+            std::vector<EntryRecord> entryRecords;
+            ct->forEach([&](const NodeKey& key, IEdge* edge) {
+                EntryRecord record = {};
+                if (!translateKey(key, ids, record.key))
+                    return;
+                record.result = writeEdge(edge, positions, record.resultWeight);
+                entryRecords.push_back(record);
+            });
+
+            Header header = makeHeader();
+            header.normalized = dd->isNormalized() ? 1 : 0;
+            header.numNodes = nodeRecords.size();
+            header.numEntries = entryRecords.size();
+            header.head = writeEdge(dd->getHeadEdge(), positions, header.headWeight);
+            write(out, &header, 1);
+            write(out, nodeRecords.data(), nodeRecords.size());
+            write(out, entryRecords.data(), entryRecords.size());
+            if (!out)
+                throw std::runtime_error("Snapshot: write failed");
+        }
+
+        // The DD owns a new arena holding every node and edge of the snapshot
+        static DD* load(std::istream& in) {
+            Header header;
+            read(in, &header, 1);
+            Header expected = makeHeader();
+            if (header.magic != expected.magic || header.version != expected.version
+                    || header.recordSizes != expected.recordSizes)
+                throw std::runtime_error("Snapshot: not a snapshot of this version");
+            if (header.modulus != expected.modulus)
+                throw std::runtime_error("Snapshot: saved with another modulus");
+            std::vector<NodeRecord> nodeRecords(header.numNodes);
+            std::vector<EntryRecord> entryRecords(header.numEntries);
+            read(in, nodeRecords.data(), nodeRecords.size());
+            read(in, entryRecords.data(), entryRecords.size());
+
+            Arena* arena = new Arena();
+            Arena::Scope scope(arena);
+            // nodes[id] is the node of stable id id, nodes[0] stays nullptr
+            std::vector<INode*> nodes(nodeRecords.size() + 1, nullptr);
+            // Nodes per level, which spares DD a walk over the diagram to size its tables
+            std::vector<std::size_t> levelSizes;
+            DD* dd = nullptr;
+            try {
+                for (std::size_t i = 0; i < nodeRecords.size(); i++) {
+                    NodeRecord& record = nodeRecords[i];
+                    // Children come first, so ids at or above the current one are corrupt
+                    IEdge* left = readEdge(record.left, record.leftWeight, nodes, i + 1);
+                    IEdge* right = readEdge(record.right, record.rightWeight, nodes, i + 1);
+                    INode* node = left == nullptr && right == nullptr ? new Node() : new Node(left, right);
+                    if ((std::size_t) node->getLevel() >= levelSizes.size())
+                        levelSizes.resize(node->getLevel() + 1);
+                    levelSizes[node->getLevel()]++;
+                    nodes[i + 1] = node;
+                }
+                if (header.head == 0)
+                    throw std::runtime_error("Snapshot: missing head edge");
+                IEdge* head = readEdge(header.head, header.headWeight, nodes, nodes.size());
+                dd = new DD(head, arena, levelSizes);
+                IUniqueTable* ut = dd->getUniqueTable();
+                for (std::size_t i = 0; i < nodeRecords.size(); i++) {
+                    if (nodeRecords[i].flags & IN_UNIQUE_TABLE)
+                        ut->lookup(nodes[i + 1]);
+                }
+                // The diagram of a normalized DD is normalized already, see DD::normalizeDiagram
+                dd->setNormalized(header.normalized != 0);
+                IComputeTable* ct = dd->getComputeTable();
+                for (EntryRecord& record : entryRecords) {
+                    NodeKey key = record.key;
+                    key.leftId = runtimeId(key.leftId, nodes);
+                    key.rightId = runtimeId(key.rightId, nodes);
+                    ct->insert(key, readEdge(record.result, record.resultWeight, nodes, nodes.size()));
+                }
+                return dd;
+            } catch (...) {
+                // Once built, the DD owns the arena
+                if (dd != nullptr)
+                    delete dd;
+                else
+                    delete arena;
+                throw;
+            }
+        }
+
+        // Every node below roots, children before parents. Also the order of MappedDD.
+        static std::vector<INode*> collectNodes(std::vector<INode*>& roots) {
+            std::vector<INode*> nodes;
+            std::unordered_set<INode*> visited;
+            for (INode* root : roots) {
+                if (visited.insert(root).second)
+                    nodes.push_back(root);
+            }
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                for (IEdge* edge : {nodes[i]->getLeftEdge(), nodes[i]->getRightEdge()}) {
+                    if (edge != nullptr && visited.insert(edge->getNode()).second)
+                        nodes.push_back(edge->getNode());
+                }
+            }
+            // A node sits above its children, see Node::getLevel
+            std::stable_sort(nodes.begin(), nodes.end(), [](INode* a, INode* b) {
+                return a->getLevel() < b->getLevel();
+            });
+            return nodes;
+        }
+
+    // Private methods
+    private:
+        struct Weight {
+            int64_t real;
+            int64_t imaginary;
+        };
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            int64_t modulus;
+            uint32_t recordSizes;
+            uint32_t normalized;
+            uint64_t numNodes;
+            uint64_t numEntries;
+            uint64_t head;
+            Weight headWeight;
+        };
+
+        // A child id of 0 has no edge and a zero weight
+        struct NodeRecord {
+            uint32_t left;
+            uint32_t right;
+            uint32_t flags;
+            uint32_t padding;
+            Weight leftWeight;
+            Weight rightWeight;
+        };
+
+        struct EntryRecord {
+            NodeKey key;
+            uint64_t result;
+            Weight resultWeight;
+        };
+
+        static const uint32_t MAGIC = 0x53444454; // "TDDS"
+        static const uint32_t VERSION = 1;
+        static const uint32_t IN_UNIQUE_TABLE = 1;
+
+        static Header makeHeader() {
+            Header header = {};
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.modulus = ComplexNumber::getModulus();
+            header.recordSizes = (uint32_t) (sizeof(Header) << 16 | sizeof(NodeRecord) << 8 | sizeof(EntryRecord));
+            return header;
+        }
+
+        static uint32_t writeEdge(IEdge* edge, std::unordered_map<INode*, uint32_t>& positions, Weight& weight) {
+            weight = {0, 0};
+            if (edge == nullptr)
+                return 0;
+            weight = {edge->getValue().getRealPart(), edge->getValue().getImaginaryPart()};
+            return positions.find(edge->getNode())->second;
+        }
+
+        static IEdge* readEdge(uint64_t id, const Weight& weight, std::vector<INode*>& nodes, std::size_t limit) {
+            if (id == 0)
+                return nullptr;
+            if (id >= limit)
+                throw std::runtime_error("Snapshot: corrupt node id");
+            return new Edge(ComplexNumber(weight.real, weight.imaginary), nodes[id]);
+        }
+
+        // False if a child of the key is not in the snapshot
+        static bool translateKey(const NodeKey& key, std::unordered_map<uint64_t, uint32_t>& ids, NodeKey& out) {
+            out = key;
+            for (uint64_t* id : {&out.leftId, &out.rightId}) {
+                if (*id == 0)
+                    continue;
+                auto it = ids.find(*id);
+                if (it == ids.end())
+                    return false;
+                *id = it->second;
+            }
+            return true;
+        }
+
+        static uint64_t runtimeId(uint64_t id, std::vector<INode*>& nodes) {
+            if (id == 0)
+                return 0;
+            if (id >= nodes.size())
+                throw std::runtime_error("Snapshot: corrupt node id");
+            return nodes[id]->getId();
+        }
+
+        template<typename T>
+        static void write(std::ostream& out, const T* data, std::size_t count) {
+            out.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+        }
+
+        template<typename T>
+        static void read(std::istream& in, T* data, std::size_t count) {
+            in.read(reinterpret_cast<char*>(data), count * sizeof(T));
+            if (!in)
+                throw std::runtime_error("Snapshot: truncated");
+        }
+};
+#endif
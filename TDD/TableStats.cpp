@@ -0,0 +1,85 @@
+#include <atomic>
+
+#ifndef TABLE_STATS_H // include guard
+#define TABLE_STATS_H
+// Snapshot of the activity of a unique or compute table
+struct TableStats {
+    long lookups;
+    long hits;
+    long misses;
+    long inserts;
+    long overwrites;
+    long entries;
+};
+
+// Snapshot of both tables of a DD
+struct DDTableStats {
+    TableStats unique;
+    TableStats compute;
+};
+
+// Counters behind TableStats. They cost one relaxed load per event while disabled, which
+// is the default.
+class TableCounters {
+    // Constructors
+    public:
+        TableCounters() {
+            enabled = false;
+            reset();
+        }
+    // Methods
+    public:
+        bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        void setEnabled(bool enabled) {
+            this->enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        void countLookup(bool hit) {
+            if (!isEnabled())
+                return;
+            lookups.fetch_add(1, std::memory_order_relaxed);
+            if (hit)
+                hits.fetch_add(1, std::memory_order_relaxed);
+            else
+                misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void countInsert(bool overwrite) {
+            if (!isEnabled())
+                return;
+            inserts.fetch_add(1, std::memory_order_relaxed);
+            if (overwrite)
+                overwrites.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        TableStats snapshot(long entries) {
+            TableStats stats;
+            stats.lookups = lookups.load(std::memory_order_relaxed);
+            stats.hits = hits.load(std::memory_order_relaxed);
+            stats.misses = misses.load(std::memory_order_relaxed);
+            stats.inserts = inserts.load(std::memory_order_relaxed);
+            stats.overwrites = overwrites.load(std::memory_order_relaxed);
+            stats.entries = entries;
+            return stats;
+        }
+
+        void reset() {
+            lookups = 0;
+            hits = 0;
+            misses = 0;
+            inserts = 0;
+            overwrites = 0;
+        }
+
+    private:
+        std::atomic<bool> enabled;
+        std::atomic<long> lookups;
+        std::atomic<long> hits;
+        std::atomic<long> misses;
+        std::atomic<long> inserts;
+        std::atomic<long> overwrites;
+};
+#endif
@@ -0,0 +1,69 @@
+#include <omp.h>
+#include <atomic>
+
+#ifndef TASK_LOAD_H // include guard
+#define TASK_LOAD_H
+// Counts the OpenMP tasks that have been created but not yet picked up by a thread. The
+// adaptive evaluators only split work while that queue is short: idle threads then always
+// find a subtree to steal, and busy ones stop paying for tasks nobody is waiting for.
+//
+// Each Runtime::run counts its own tasks: the threads of its team make the load of the run
+// current through a Scope, so products running at the same time on other runtimes or DDs do
+// not throttle each other. Outside a scope a process-wide load is used.
+class TaskLoad {
+    // Constructors
+    public:
+        TaskLoad() : pending(0) {}
+
+        TaskLoad(const TaskLoad&) = delete;
+        TaskLoad& operator=(const TaskLoad&) = delete;
+
+    // Methods
+    public:
+        static bool shouldSplit() {
+            return current()->pending.load(std::memory_order_relaxed) < QUEUED_PER_THREAD * omp_get_num_threads();
+        }
+
+        static void queued() {
+            current()->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void started() {
+            current()->pending.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Makes a load the current one of the calling thread for the lifetime of the scope
+        class Scope {
+            public:
+                Scope(TaskLoad* load) {
+                    previous = active();
+                    active() = load;
+                }
+
+                ~Scope() {
+                    active() = previous;
+                }
+
+            private:
+                TaskLoad* previous;
+        };
+
+    // Private methods
+    private:
+        static TaskLoad*& active() {
+            static thread_local TaskLoad* load = nullptr;
+            return load;
+        }
+
+        static TaskLoad* current() {
+            static TaskLoad processLoad;
+            TaskLoad* load = active();
+            return load != nullptr ? load : &processLoad;
+        }
+
+    private:
+        static const int QUEUED_PER_THREAD = 2;
+
+        std::atomic<int> pending;
+};
+#endif
@@ -0,0 +1,323 @@
+#include <omp.h>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "NodeKey.cpp"
+#include "Interfaces.cpp"
+#include "ComplexNumber.cpp"
+#include "ModularWeight.cpp"
+
+#ifndef TYPED_DD_H // include guard
+#define TYPED_DD_H
+// Hashing and conversion of a weight type, specialised for every weight TypedDD is used with
+template<typename Weight>
+struct WeightTraits;
+
+template<>
+struct WeightTraits<ComplexNumber> {
+    static uint64_t hash(const ComplexNumber& weight) {
+        return NodeKeyHash::mix((uint64_t) weight.getRealPart()) ^ (uint64_t) weight.getImaginaryPart();
+    }
+
+    static ComplexNumber fromComplex(const ComplexNumber& weight) {
+        return weight;
+    }
+};
+
+template<>
+struct WeightTraits<ModularWeight> {
+    static uint64_t hash(const ModularWeight& weight) {
+        return (uint64_t) weight.getValue();
+    }
+
+    // Keeps the real part
+    static ModularWeight fromComplex(const ComplexNumber& weight) {
+        return ModularWeight(weight.getRealPart());
+    }
+};
+
+// Table policies: the lock the tables of a TypedDD hold around every access
+struct SequentialTables {
+    class Lock {
+        public:
+            void set() {}
+            void unset() {}
+    };
+};
+
+struct LockedTables {
+    class Lock {
+        public:
+            Lock() {
+                omp_init_lock(&lock);
+            }
+
+            ~Lock() {
+                omp_destroy_lock(&lock);
+            }
+
+            void set() {
+                omp_set_lock(&lock);
+            }
+
+            void unset() {
+                omp_unset_lock(&lock);
+            }
+
+        private:
+            omp_lock_t lock;
+    };
+};
+
+template<typename Weight>
+struct TypedNode;
+
+// An edge is a value: the weight and the node it points to, nullptr for a missing child
+template<typename Weight>
+struct TypedEdge {
+    Weight weight;
+    const TypedNode<Weight>* node;
+
+    TypedEdge() : weight(), node(nullptr) {
+    }
+
+    TypedEdge(const Weight& weight, const TypedNode<Weight>* node) : weight(weight), node(node) {
+    }
+
+    bool operator==(const TypedEdge& other) const {
+        return node == other.node && weight == other.weight;
+    }
+};
+
+// Both children are stored inline, a node is its own unique table key
+template<typename Weight>
+struct TypedNode {
+    TypedEdge<Weight> left;
+    TypedEdge<Weight> right;
+
+    bool operator==(const TypedNode& other) const {
+        return left == other.left && right == other.right;
+    }
+};
+
+template<typename Weight>
+struct TypedNodeHash {
+    std::size_t operator()(const TypedNode<Weight>& node) const {
+        uint64_t h = NodeKeyHash::mix((uint64_t) (uintptr_t) node.left.node);
+        h = NodeKeyHash::mix(h ^ WeightTraits<Weight>::hash(node.left.weight));
+        h = NodeKeyHash::mix(h ^ (uint64_t) (uintptr_t) node.right.node);
+        h = NodeKeyHash::mix(h ^ WeightTraits<Weight>::hash(node.right.weight));
+        return (std::size_t) h;
+    }
+};
+
+// Hash-consing set that also owns the nodes: set elements never move, so a node is
+// identified by its address for as long as the table lives.
+template<typename Weight, typename TablePolicy>
+class TypedUniqueTable {
+    typedef TypedNode<Weight> Node;
+    typedef TypedEdge<Weight> Edge;
+
+    // Methods
+    public:
+        const Node* lookup(const Edge& left, const Edge& right) {
+            Node candidate = {left, right};
+            lock.set();
+            const Node* node = &*table.insert(candidate).first;
+            lock.unset();
+            return node;
+        }
+
+        std::size_t size() {
+            lock.set();
+            std::size_t entries = table.size();
+            lock.unset();
+            return entries;
+        }
+
+    private:
+        std::unordered_set<Node, TypedNodeHash<Weight>> table;
+        typename TablePolicy::Lock lock;
+};
+
+// Direct-mapped, lossy compute table from a node to the product edge of its subdiagram,
+// the same scheme as ComputeTable
+template<typename Weight, typename TablePolicy>
+class TypedComputeTable {
+    typedef TypedNode<Weight> Node;
+    typedef TypedEdge<Weight> Edge;
+
+    // Constructors
+    public:
+        // size is rounded up to a power of two
+        TypedComputeTable(std::size_t size = DEFAULT_SIZE) {
+            std::size_t rounded = 1;
+            while (rounded < size)
+                rounded *= 2;
+            mask = rounded - 1;
+            slots = new Slot[rounded];
+        }
+
+        ~TypedComputeTable() {
+            delete[] slots;
+        }
+
+        TypedComputeTable(const TypedComputeTable&) = delete;
+        TypedComputeTable& operator=(const TypedComputeTable&) = delete;
+
+    // Methods
+    public:
+        bool lookup(const Node* node, Edge& result) {
+            Slot& slot = getSlot(node);
+            lock.set();
+            bool found = slot.node == node;
+            if (found)
+                result = slot.edge;
+            lock.unset();
+            return found;
+        }
+
+        void insert(const Node* node, const Edge& result) {
+            Slot& slot = getSlot(node);
+            lock.set();
+            slot.node = node;
+            slot.edge = result;
+            lock.unset();
+        }
+
+    private:
+        struct Slot {
+            const Node* node = nullptr;
+            Edge edge;
+        };
+
+        Slot& getSlot(const Node* node) {
+            return slots[NodeKeyHash::mix((uint64_t) (uintptr_t) node) & mask];
+        }
+
+    private:
+        static const std::size_t DEFAULT_SIZE = (std::size_t) 1 << 16;
+
+        Slot* slots;
+        std::size_t mask;
+        typename TablePolicy::Lock lock;
+};
+
+// DD whose weight, node and table types are fixed at compile time. Edges are values and
+// children are plain fields, so the product recursion has no virtual calls and inlines.
+// Nodes are hash-consed on construction and owned by the unique table: they live as long
+// as the TypedDD, there is no garbage collection.
+template<typename Weight, typename TablePolicy = SequentialTables>
+class TypedDD {
+    public:
+        typedef TypedNode<Weight> Node;
+        typedef TypedEdge<Weight> Edge;
+
+    // Constructors
+    public:
+        TypedDD() {
+            headEdge = Edge(Weight(), getLeaf());
+        }
+
+        // Imports a diagram of the virtual Node and Edge classes. Shared nodes stay shared.
+        TypedDD(IEdge* edge) {
+            std::unordered_map<INode*, const Node*> imported;
+            headEdge = importEdge(edge, imported);
+        }
+
+        TypedDD(const TypedDD&) = delete;
+        TypedDD& operator=(const TypedDD&) = delete;
+
+    // Methods
+    public:
+        const Node* getLeaf() {
+            return ut.lookup(Edge(), Edge());
+        }
+
+        const Node* makeNode(const Edge& left, const Edge& right) {
+            return ut.lookup(left, right);
+        }
+
+        Edge getHeadEdge() {
+            return headEdge;
+        }
+
+        void setHeadEdge(const Edge& edge) {
+            headEdge = edge;
+        }
+
+        std::size_t getNodeCount() {
+            return ut.size();
+        }
+
+        Weight getProduct() {
+            return getProduct(headEdge);
+        }
+
+        Weight getDDProduct() {
+            headEdge = getDDProduct(headEdge);
+            return headEdge.weight;
+        }
+
+    // Private methods
+    private:
+        Weight getProduct(const Edge& edge) {
+            Weight value = edge.weight;
+            if (edge.node->left.node != nullptr)
+                value = value.product(getProduct(edge.node->left));
+            if (edge.node->right.node != nullptr)
+                value = value.product(getProduct(edge.node->right));
+            return value;
+        }
+
+        Edge getDDProduct(const Edge& edge) {
+            Edge result;
+            if (!ct.lookup(edge.node, result)) {
+                result = getDDProduct(edge.node);
+                ct.insert(edge.node, result);
+            }
+            return Edge(result.weight.product(edge.weight), result.node);
+        }
+
+        Edge getDDProduct(const Node* node) {
+            Weight value = Weight();
+            Edge left;
+            Edge right;
+            if (node->left.node != nullptr) {
+                left = getDDProduct(node->left);
+                value = value.product(left.weight);
+            }
+            if (node->right.node != nullptr) {
+                right = getDDProduct(node->right);
+                value = value.product(right.weight);
+            }
+            return Edge(value, ut.lookup(left, right));
+        }
+
+        Edge importEdge(IEdge* edge, std::unordered_map<INode*, const Node*>& imported) {
+            INode* source = edge->getNode();
+            auto it = imported.find(source);
+            const Node* node;
+            if (it != imported.end()) {
+                node = it->second;
+            } else {
+                Edge left;
+                Edge right;
+                if (source->getLeftEdge() != nullptr)
+                    left = importEdge(source->getLeftEdge(), imported);
+                if (source->getRightEdge() != nullptr)
+                    right = importEdge(source->getRightEdge(), imported);
+                node = ut.lookup(left, right);
+                imported.emplace(source, node);
+            }
+            return Edge(WeightTraits<Weight>::fromComplex(edge->getValue()), node);
+        }
+
+    private:
+        Edge headEdge;
+        TypedUniqueTable<Weight, TablePolicy> ut;
+        TypedComputeTable<Weight, TablePolicy> ct;
+};
+#endif
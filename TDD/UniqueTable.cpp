@@ -1,10 +1,55 @@
 #include <omp.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
 
 #include "Interfaces.cpp"
 
 #ifndef UNIQUE_TABLE_H // include guard
 #define UNIQUE_TABLE_H
 
+// Moves the nodes nobody references any more from table to dead
+static void takeDeadNodes(std::unordered_map<NodeKey, INode*, NodeKeyHash>& table, std::vector<INode*>& dead) {
+    for (auto it = table.begin(); it != table.end();) {
+        if (it->second->getRefCount() == 0) {
+            dead.push_back(it->second);
+            it = table.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Removes node from table if it is the entry of its key
+static bool eraseNode(std::unordered_map<NodeKey, INode*, NodeKeyHash>& table, INode* node) {
+    auto it = table.find(node->getKey());
+    if (it == table.end() || it->second != node)
+        return false;
+    table.erase(it);
+    return true;
+}
+
+// Frees the dead nodes. Freeing a node releases its edges, which can kill its children:
+// erase removes such a child from its table and it joins the worklist, so a single scan
+// of the tables collects a dead diagram of any depth.
+static std::size_t freeDeadNodes(std::vector<INode*>& dead, std::function<bool(INode*)> erase) {
+    std::size_t collected = 0;
+    while (!dead.empty()) {
+        INode* node = dead.back();
+        dead.pop_back();
+        INode* left = node->getLeftEdge() != nullptr ? node->getLeftEdge()->getNode() : nullptr;
+        INode* right = node->getRightEdge() != nullptr ? node->getRightEdge()->getNode() : nullptr;
+        delete node;
+        collected++;
+        if (left != nullptr && left->getRefCount() == 0 && erase(left))
+            dead.push_back(left);
+        if (right != nullptr && right != left && right->getRefCount() == 0 && erase(right))
+            dead.push_back(right);
+    }
+    return collected;
+}
+
 class UniqueTable : public IUniqueTable {
     // Constructors
     public:
@@ -15,53 +60,335 @@ class UniqueTable : public IUniqueTable {
     public:
         INode* lookup(INode* node) {
             //return node;                                          // -------------------------------------------------- Deactivate
+            NodeKey key = node->getKey();
             omp_set_lock(&insertLock);
             INode* dev = node;
-            std::size_t hashResult = std::hash<std::string>{}(node->getString());
-            if (table.find(hashResult) == table.end()) {
-                insert(node);
+            auto it = table.find(key);
+            if (it == table.end()) {
+                table.emplace(key, node);
+                counters.countInsert(false);
             } else {
-                dev = table[hashResult];
+                dev = it->second;
             }
+            counters.countLookup(dev != node);
             omp_unset_lock(&insertLock);
             return dev;
         }
 
         void insert(INode* node) {
             //std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            std::size_t hashResult = std::hash<std::string>{}(node->getString());
-            table[hashResult] = node;
+            auto result = table.insert_or_assign(node->getKey(), node);
+            counters.countInsert(!result.second);
+        }
+
+        // Must not run concurrently with lookups
+        void forEach(std::function<void(INode*)> f) {
+            for (auto& entry : table)
+                f(entry.second);
+        }
+
+        TableStats getStats() {
+            omp_set_lock(&insertLock);
+            long entries = table.size();
+            omp_unset_lock(&insertLock);
+            return counters.snapshot(entries);
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
+        }
+
+        std::size_t garbageCollect() {
+            std::vector<INode*> dead;
+            omp_set_lock(&insertLock);
+            takeDeadNodes(table, dead);
+            std::size_t collected = freeDeadNodes(dead, [&](INode* node) {
+                return eraseNode(table, node);
+            });
+            omp_unset_lock(&insertLock);
+            return collected;
         }
         
     private:
-        std::map<std::size_t, INode*> table;
+        std::unordered_map<NodeKey, INode*, NodeKeyHash> table;
         omp_lock_t insertLock;
+        TableCounters counters;
 };
 
-class UniqueTablePrivate : public IUniqueTable {
+class ConcurrentUniqueTable : public IUniqueTable {
     // Constructors
     public:
-        UniqueTablePrivate() {
+        // numShards is rounded up to a power of two
+        ConcurrentUniqueTable(int numShards = 64) {
+            this->numShards = 1;
+            while (this->numShards < numShards)
+                this->numShards *= 2;
+            shards = new Shard[this->numShards];
+            for (int i = 0; i < this->numShards; i++)
+                omp_init_lock(&shards[i].lock);
+        }
+
+        ~ConcurrentUniqueTable() {
+            for (int i = 0; i < numShards; i++)
+                omp_destroy_lock(&shards[i].lock);
+            delete[] shards;
         }
     // Methods
     public:
         INode* lookup(INode* node) {
-            INode* dev = node;
-            if (table.find(node->getString()) == table.end()) {
-                insert(node);
-            } else {
-                dev = table[node->getString()];
+            NodeKey key = node->getKey();
+            Shard& shard = getShard(key);
+            omp_set_lock(&shard.lock);
+            auto result = shard.table.emplace(key, node);
+            INode* dev = result.first->second;
+            omp_unset_lock(&shard.lock);
+            counters.countLookup(!result.second);
+            if (result.second)
+                counters.countInsert(false);
+            return dev;
+        }
+
+        void insert(INode* node) {
+            NodeKey key = node->getKey();
+            Shard& shard = getShard(key);
+            omp_set_lock(&shard.lock);
+            auto result = shard.table.insert_or_assign(key, node);
+            omp_unset_lock(&shard.lock);
+            counters.countInsert(!result.second);
+        }
+
+        // Must not run concurrently with lookups
+        void forEach(std::function<void(INode*)> f) {
+            for (int i = 0; i < numShards; i++)
+                for (auto& entry : shards[i].table)
+                    f(entry.second);
+        }
+
+        TableStats getStats() {
+            long entries = 0;
+            for (int i = 0; i < numShards; i++) {
+                omp_set_lock(&shards[i].lock);
+                entries += shards[i].table.size();
+                omp_unset_lock(&shards[i].lock);
+            }
+            return counters.snapshot(entries);
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
+        }
+
+        std::size_t garbageCollect() {
+            std::vector<INode*> dead;
+            for (int i = 0; i < numShards; i++) {
+                omp_set_lock(&shards[i].lock);
+                takeDeadNodes(shards[i].table, dead);
+                omp_unset_lock(&shards[i].lock);
             }
+            return freeDeadNodes(dead, [&](INode* node) {
+                NodeKey key = node->getKey();
+                Shard& shard = getShard(key);
+                omp_set_lock(&shard.lock);
+                bool erased = eraseNode(shard.table, node);
+                omp_unset_lock(&shard.lock);
+                return erased;
+            });
+        }
+
+    private:
+        // One lock and one map per shard, padded so neighbouring locks do not share a cache line
+        struct alignas(64) Shard {
+            omp_lock_t lock;
+            std::unordered_map<NodeKey, INode*, NodeKeyHash> table;
+        };
+
+        Shard& getShard(const NodeKey& key) {
+            // The map consumes the low bits of the hash, so select the shard with the high ones
+            return shards[(NodeKeyHash{}(key) >> 32) & (numShards - 1)];
+        }
+
+    private:
+        Shard* shards;
+        int numShards;
+        TableCounters counters;
+};
+
+// One sub-table and one lock per node level. Nodes of different levels are never equal,
+// so threads working on different levels never contend. Levels past the last sub-table
+// share it. Threads filling the same level at once, see DDBuilder::pairs, spread over
+// numShards sub-tables of that level, chosen by key hash as in ConcurrentUniqueTable.
+class LevelUniqueTable : public IUniqueTable {
+    // Constructors
+    public:
+        // numShards is rounded up to a power of two
+        LevelUniqueTable(int numLevels = DEFAULT_LEVELS, int numShards = 1) {
+            this->numLevels = numLevels;
+            this->numShards = 1;
+            while (this->numShards < numShards)
+                this->numShards *= 2;
+            levels = new Level[numLevels * this->numShards];
+            for (int i = 0; i < numLevels * this->numShards; i++)
+                omp_init_lock(&levels[i].lock);
+        }
+
+        ~LevelUniqueTable() {
+            for (int i = 0; i < numLevels * numShards; i++)
+                omp_destroy_lock(&levels[i].lock);
+            delete[] levels;
+        }
+    // Methods
+    public:
+        static const int DEFAULT_LEVELS = 64;
+
+        INode* lookup(INode* node) {
+            NodeKey key = node->getKey();
+            Level& level = getLevel(node->getLevel(), key);
+            omp_set_lock(&level.lock);
+            // Unlike emplace, try_emplace does not allocate an entry for a key already present
+            auto result = level.table.try_emplace(key, node);
+            INode* dev = result.first->second;
+            omp_unset_lock(&level.lock);
+            counters.countLookup(!result.second);
+            if (result.second)
+                counters.countInsert(false);
             return dev;
         }
 
+        void insert(INode* node) {
+            NodeKey key = node->getKey();
+            Level& level = getLevel(node->getLevel(), key);
+            omp_set_lock(&level.lock);
+            auto result = level.table.insert_or_assign(key, node);
+            omp_unset_lock(&level.lock);
+            counters.countInsert(!result.second);
+        }
+
+        // Must not run concurrently with lookups
+        void forEach(std::function<void(INode*)> f) {
+            for (int i = 0; i < numLevels * numShards; i++)
+                for (auto& entry : levels[i].table)
+                    f(entry.second);
+        }
+
+        // Levels from getNumLevels() - 1 up share the last sub-table
+        int getNumLevels() {
+            return numLevels;
+        }
+
+        // Sizes the sub-table of level for count nodes, so it does not rehash while filling up
+        void reserve(int level, std::size_t count) {
+            Level* shards = getShards(level);
+            for (int i = 0; i < numShards; i++) {
+                omp_set_lock(&shards[i].lock);
+                shards[i].table.reserve(shards[i].table.size() + count / numShards);
+                omp_unset_lock(&shards[i].lock);
+            }
+        }
+
+        TableStats getStats() {
+            long entries = 0;
+            for (int i = 0; i < numLevels * numShards; i++) {
+                omp_set_lock(&levels[i].lock);
+                entries += levels[i].table.size();
+                omp_unset_lock(&levels[i].lock);
+            }
+            return counters.snapshot(entries);
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
+        }
+
+        // One scan of the sub-tables, the nodes killed by freeing others are erased from
+        // the sub-table of their level and freed in the same pass, see freeDeadNodes
+        std::size_t garbageCollect() {
+            std::vector<INode*> dead;
+            for (int i = 0; i < numLevels * numShards; i++) {
+                omp_set_lock(&levels[i].lock);
+                takeDeadNodes(levels[i].table, dead);
+                omp_unset_lock(&levels[i].lock);
+            }
+            return freeDeadNodes(dead, [&](INode* node) {
+                NodeKey key = node->getKey();
+                Level& level = getLevel(node->getLevel(), key);
+                omp_set_lock(&level.lock);
+                bool erased = eraseNode(level.table, node);
+                omp_unset_lock(&level.lock);
+                return erased;
+            });
+        }
+
+    private:
+        struct alignas(64) Level {
+            omp_lock_t lock;
+            std::unordered_map<NodeKey, INode*, NodeKeyHash> table;
+        };
+
+        // The numShards sub-tables of level
+        Level* getShards(int level) {
+            return levels + std::min(level, numLevels - 1) * numShards;
+        }
+
+        Level& getLevel(int level, const NodeKey& key) {
+            Level* shards = getShards(level);
+            if (numShards == 1)
+                return shards[0];
+            return shards[(NodeKeyHash{}(key) >> 32) & (numShards - 1)];
+        }
+
+    private:
+        Level* levels;
+        int numLevels;
+        int numShards;
+        TableCounters counters;
+};
+
+class UniqueTablePrivate : public IUniqueTable {
+    // Constructors
+    public:
+        UniqueTablePrivate() {
+        }
+    // Methods
+    public:
+        INode* lookup(INode* node) {
+            auto result = table.emplace(node->getKey(), node);
+            counters.countLookup(!result.second);
+            if (result.second)
+                counters.countInsert(false);
+            return result.first->second;
+        }
+
         void insert(INode* node) {
             //std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            table[node->getString()] = node;
+            auto result = table.insert_or_assign(node->getKey(), node);
+            counters.countInsert(!result.second);
+        }
+
+        // Must not run concurrently with lookups
+        void forEach(std::function<void(INode*)> f) {
+            for (auto& entry : table)
+                f(entry.second);
+        }
+
+        TableStats getStats() {
+            return counters.snapshot(table.size());
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
+        }
+
+        std::size_t garbageCollect() {
+            std::vector<INode*> dead;
+            takeDeadNodes(table, dead);
+            return freeDeadNodes(dead, [&](INode* node) {
+                return eraseNode(table, node);
+            });
         }
 
     private:
-        std::map<string, INode*> table;
+        std::unordered_map<NodeKey, INode*, NodeKeyHash> table;
+        TableCounters counters;
 };
 
 class CachedUniqueTable : public IUniqueTable {
@@ -69,32 +396,73 @@ class CachedUniqueTable : public IUniqueTable {
     public:
         CachedUniqueTable(IUniqueTable* ut) {
             this->ut = ut;
+            omp_init_lock(&tableLock);
         }
     // Methods
     public:
         INode* lookup(INode* node) {
             INode* dev = node;
-            std::size_t hashResult = std::hash<std::string>{}(node->getString());
-            if (table.find(hashResult) == table.end()) {
+            NodeKey key = node->getKey();
+            // The insert tasks below may be running on other threads
+            omp_set_lock(&tableLock);
+            auto it = table.find(key);
+            bool found = it != table.end();
+            if (found)
+                dev = it->second;
+            omp_unset_lock(&tableLock);
+            counters.countLookup(found);
+            if (!found) {
                 #pragma omp task
                 insert(node);
-            } else {
-                dev = table[hashResult];
             }
             return dev;
         }
         
         void insert(INode* node) {
-            std::size_t hashResult = std::hash<std::string>{}(node->getString());
-            #pragma omp critical
-            {
+            NodeKey key = node->getKey();
             node = ut->lookup(node);
-            table[hashResult] = node;
-            }
+            omp_set_lock(&tableLock);
+            auto result = table.insert_or_assign(key, node);
+            omp_unset_lock(&tableLock);
+            counters.countInsert(!result.second);
+        }
+
+        // The nodes belong to the wrapped table
+        void forEach(std::function<void(INode*)> f) {
+            ut->forEach(f);
+        }
+
+        // The nodes belong to the wrapped table, only the local copies are dropped
+        std::size_t garbageCollect() {
+            table.clear();
+            return 0;
+        }
+
+        // Activity of the local cache, the wrapped table keeps its own statistics
+        TableStats getStats() {
+            omp_set_lock(&tableLock);
+            long entries = table.size();
+            omp_unset_lock(&tableLock);
+            return counters.snapshot(entries);
+        }
+
+        void setStatsEnabled(bool enabled) {
+            counters.setEnabled(enabled);
+        }
+
+        // The flag belongs to the wrapped table
+        void setNormalized(bool normalized) {
+            ut->setNormalized(normalized);
+        }
+
+        bool isNormalized() {
+            return ut->isNormalized();
         }
     
     private:
-        std::map<std::size_t, INode*> table;
+        std::unordered_map<NodeKey, INode*, NodeKeyHash> table;
+        omp_lock_t tableLock;
         IUniqueTable* ut;
+        TableCounters counters;
 };
 #endif
@@ -1,3 +1,7 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <stdexcept>
 
 #ifndef UTILS_H // include guard
 #define UTILS_H
@@ -0,0 +1,362 @@
+#include <omp.h>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+#include "TDD/Interfaces.cpp"
+#include "TDD/ComplexNumber.cpp"
+#include "TDD/Node.cpp"
+#include "TDD/Edge.cpp"
+#include "TDD/DD.cpp"
+#include "TDD/BatchProduct.cpp"
+#include "TDD/TypedDD.cpp"
+#include "TDD/NodeStore.cpp"
+#include "DDExamples.cpp"
+
+//  ------------------------------ Options ------------------------------
+
+struct Options {
+    int trials = 15;
+    int warmup = 2;
+    int level = 2;
+    int threads = 0;
+    string scenario = "all";
+    string format = "table";
+};
+
+void printUsage(char* program) {
+    cerr << "Usage: " << program << " [--trials N] [--warmup N] [--level N] [--threads N]"
+         << " [--scenario small|controlated|large|equal|scaled|modmul|batch|all] [--csv|--json]\n";
+    exit(1);
+}
+
+// The whole of value as a number of at least minimum, anything else is a usage error
+int parseCount(const string& value, int minimum, char* program) {
+    char* end = nullptr;
+    long count = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || count < minimum || count > INT_MAX)
+        printUsage(program);
+    return (int) count;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--trials") { options.trials = parseCount(value, 1, argv[0]); i++; }
+        else if (arg == "--warmup") { options.warmup = parseCount(value, 0, argv[0]); i++; }
+        else if (arg == "--level") { options.level = parseCount(value, 0, argv[0]); i++; }
+        else if (arg == "--threads") { options.threads = parseCount(value, 1, argv[0]); i++; }
+        else if (arg == "--scenario") { options.scenario = value; i++; }
+        else if (arg == "--csv") { options.format = "csv"; }
+        else if (arg == "--json") { options.format = "json"; }
+        else printUsage(argv[0]);
+    }
+    return options;
+}
+
+//  ---------------------------- Statistics -----------------------------
+
+struct Summary {
+    string scenario;
+    string strategy;
+    string mode;
+    int trials;
+    double median;
+    double p95;
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    string result;
+};
+
+// Nearest-rank percentile of sorted samples
+double percentile(const vector<double>& sorted, double p) {
+    int rank = (int) ceil(p * sorted.size());
+    return sorted[max(rank, 1) - 1];
+}
+
+Summary summarize(vector<double> samples) {
+    Summary summary = {};
+    sort(samples.begin(), samples.end());
+    double sum = 0;
+    for(double sample : samples)
+        sum += sample;
+    summary.trials = samples.size();
+    summary.mean = sum / samples.size();
+    double squares = 0;
+    for(double sample : samples)
+        squares += (sample - summary.mean) * (sample - summary.mean);
+    summary.stddev = samples.size() > 1 ? sqrt(squares / (samples.size() - 1)) : 0;
+    summary.median = percentile(samples, 0.5);
+    summary.p95 = percentile(samples, 0.95);
+    summary.min = samples.front();
+    summary.max = samples.back();
+    return summary;
+}
+
+//  ---------------------------- Measurement ----------------------------
+
+struct Strategy {
+    string name;
+    function<ComplexNumber(DD*)> run;
+};
+
+double timeRun(const Strategy& strategy, DD* dd, string& result) {
+    auto start = chrono::high_resolution_clock::now();
+    ComplexNumber value = strategy.run(dd);
+    chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+    result = value.get_string();
+    return duration.count();
+}
+
+// Cold: every trial multiplies a freshly built DD with empty tables, building is not timed
+Summary measureCold(DD* (*createDD)(), const Strategy& strategy, const Options& options, Runtime* runtime) {
+    vector<double> samples;
+    string result;
+    for(int i = 0; i < options.warmup + options.trials; i++) {
+        DD* dd = createDD();
+        dd->setRuntime(runtime);
+        double sample = timeRun(strategy, dd, result);
+        if (i >= options.warmup)
+            samples.push_back(sample);
+        delete dd;
+    }
+    Summary summary = summarize(samples);
+    summary.result = result;
+    return summary;
+}
+
+// Warm: one DD multiplied repeatedly, so the tables already hold the previous results
+Summary measureWarm(DD* (*createDD)(), const Strategy& strategy, const Options& options, Runtime* runtime) {
+    vector<double> samples;
+    string result;
+    DD* dd = createDD();
+    dd->setRuntime(runtime);
+    for(int i = 0; i < options.warmup + options.trials; i++) {
+        double sample = timeRun(strategy, dd, result);
+        if (i >= options.warmup)
+            samples.push_back(sample);
+    }
+    delete dd;
+    Summary summary = summarize(samples);
+    summary.result = result;
+    return summary;
+}
+
+// The same two modes for the engines built from a DD: TypedDD and NodeStore. The engine is
+// imported from a freshly built DD, untimed.
+template<typename Engine>
+Summary measureImported(DD* (*createDD)(), const Options& options, bool cold) {
+    vector<double> samples;
+    string result;
+    DD* dd = createDD();
+    Engine* engine = new Engine(dd->getHeadEdge());
+    for(int i = 0; i < options.warmup + options.trials; i++) {
+        if (cold && i > 0) {
+            delete engine;
+            engine = new Engine(dd->getHeadEdge());
+        }
+        auto start = chrono::high_resolution_clock::now();
+        ComplexNumber value = engine->getDDProduct();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        result = value.get_string();
+        if (i >= options.warmup)
+            samples.push_back(duration.count());
+    }
+    delete engine;
+    delete dd;
+    Summary summary = summarize(samples);
+    summary.result = result;
+    return summary;
+}
+
+// Throughput of the modular complex product kernel, once per reducer
+template<typename Reducer>
+double timeModularProducts(const vector<long>& values, long& checksum) {
+    auto start = chrono::high_resolution_clock::now();
+    long real = 1;
+    long imaginary = 0;
+    for(size_t i = 0; i + 1 < values.size(); i += 2) {
+        long newReal = real * values[i] - imaginary * values[i + 1];
+        long newImaginary = real * values[i + 1] + imaginary * values[i];
+        real = Reducer::reduce(newReal);
+        imaginary = Reducer::reduce(newImaginary);
+    }
+    chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+    checksum = real ^ imaginary;
+    return duration.count();
+}
+
+template<typename Reducer>
+Summary measureModularProducts(const Options& options) {
+    const long MOD = ComplexNumber::getModulus();
+    vector<long> values(1 << 22);
+    for(size_t i = 0; i < values.size(); i++)
+        values[i] = ((long) i * 2654435761L) % MOD - MOD / 2;
+    vector<double> samples;
+    long checksum = 0;
+    for(int i = 0; i < options.warmup + options.trials; i++) {
+        double sample = timeModularProducts<Reducer>(values, checksum);
+        if (i >= options.warmup)
+            samples.push_back(sample);
+    }
+    Summary summary = summarize(samples);
+    summary.result = to_string(checksum);
+    return summary;
+}
+
+// Element-wise products of 2^20 weight pairs, as done for one level of leaf edges
+typedef void (*BatchKernel)(const ComplexNumber*, const ComplexNumber*, ComplexNumber*, size_t);
+
+Summary measureBatchProducts(BatchKernel kernel, const Options& options) {
+    const long MOD = ComplexNumber::getModulus();
+    size_t n = 1 << 20;
+    vector<ComplexNumber> a(n), b(n), out(n);
+    for(size_t i = 0; i < n; i++) {
+        a[i] = ComplexNumber(((long) i * 2654435761L) % MOD, (long) i - MOD / 2);
+        b[i] = ComplexNumber((long) i * 40503L, -((long) i * 69069L));
+    }
+    vector<double> samples;
+    for(int i = 0; i < options.warmup + options.trials; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        kernel(a.data(), b.data(), out.data(), n);
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        if (i >= options.warmup)
+            samples.push_back(duration.count());
+    }
+    long checksum = 0;
+    for(const ComplexNumber& value : out)
+        checksum ^= value.getRealPart() * 31 + value.getImaginaryPart();
+    Summary summary = summarize(samples);
+    summary.result = to_string(checksum);
+    return summary;
+}
+
+//  ------------------------------ Output -------------------------------
+
+void printSummaries(const vector<Summary>& summaries, const Options& options, int threads) {
+    if (options.format == "csv") {
+        cout << "scenario,strategy,mode,threads,trials,median_ms,p95_ms,mean_ms,stddev_ms,min_ms,max_ms,result\n";
+        for(const Summary& s : summaries) {
+            cout << s.scenario << "," << s.strategy << "," << s.mode << "," << threads << "," << s.trials << ","
+                 << s.median << "," << s.p95 << "," << s.mean << "," << s.stddev << ","
+                 << s.min << "," << s.max << "," << s.result << "\n";
+        }
+    } else if (options.format == "json") {
+        cout << "[\n";
+        for(size_t i = 0; i < summaries.size(); i++) {
+            const Summary& s = summaries[i];
+            cout << "  {\"scenario\": \"" << s.scenario << "\", \"strategy\": \"" << s.strategy
+                 << "\", \"mode\": \"" << s.mode << "\", \"threads\": " << threads << ", \"trials\": " << s.trials
+                 << ", \"median_ms\": " << s.median << ", \"p95_ms\": " << s.p95 << ", \"mean_ms\": " << s.mean
+                 << ", \"stddev_ms\": " << s.stddev << ", \"min_ms\": " << s.min << ", \"max_ms\": " << s.max
+                 << ", \"result\": \"" << s.result << "\"}" << (i + 1 < summaries.size() ? "," : "") << "\n";
+        }
+        cout << "]\n";
+    } else {
+        printf("%-12s %-20s %-5s %10s %10s %10s %10s  %s\n",
+               "scenario", "strategy", "mode", "median ms", "p95 ms", "stddev ms", "mean ms", "result");
+        for(const Summary& s : summaries) {
+            printf("%-12s %-20s %-5s %10.3f %10.3f %10.3f %10.3f  %s\n", s.scenario.c_str(), s.strategy.c_str(),
+                   s.mode.c_str(), s.median, s.p95, s.stddev, s.mean, s.result.c_str());
+        }
+    }
+}
+
+//  --------------------------- Main program ----------------------------
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    Runtime runtime(options.threads);
+    int level = options.level;
+
+    vector<pair<string, DD* (*)()>> scenarios = {
+        {"controlated", createControlatedDD},
+        {"small", createSmallDD},
+        {"large", createLargeDD},
+        {"equal", createEqualDD},
+        {"scaled", createScaledDD},
+    };
+    vector<Strategy> strategies = {
+        {"sequential", [](DD* dd) { return dd->getDDProduct(); }},
+        {"normalized", [](DD* dd) { dd->setNormalized(true); return dd->getDDProduct(); }},
+        {"iterative", [](DD* dd) { return dd->getDDProductIterative(); }},
+        {"parallel", [level](DD* dd) { return dd->getDDProductParallel(level); }},
+        {"parallel-cached", [level](DD* dd) { return dd->getDDProductParallelCached(level); }},
+        {"parallel-private", [level](DD* dd) { return dd->getDDProductParallelPrivate(level); }},
+        {"parallel-adaptive", [](DD* dd) { return dd->getDDProductParallelAdaptive(); }},
+        {"level-parallel", [](DD* dd) { return dd->getDDProductLevelParallel(); }},
+        {"product", [](DD* dd) { return dd->getProduct(); }},
+        {"product-memoized", [](DD* dd) { return dd->getProductMemoized(); }},
+        {"product-iterative", [](DD* dd) { return dd->getProductIterative(); }},
+    };
+
+    vector<Summary> summaries;
+    // 2^21 dependent complex products per trial, the checksums must agree
+    if (options.scenario == "all" || options.scenario == "modmul") {
+        constexpr long MOD = ComplexNumber::getModulus();
+        Summary modulo = measureModularProducts<ModuloReducer<MOD>>(options);
+        modulo.scenario = "modmul";
+        modulo.strategy = "modulo";
+        modulo.mode = "-";
+        summaries.push_back(modulo);
+        Summary barrett = measureModularProducts<BarrettReducer<MOD>>(options);
+        barrett.scenario = "modmul";
+        barrett.strategy = "barrett";
+        barrett.mode = "-";
+        summaries.push_back(barrett);
+    }
+    if (options.scenario == "all" || options.scenario == "batch") {
+        Summary scalar = measureBatchProducts(BatchProduct::multiplyScalar, options);
+        scalar.scenario = "batch";
+        scalar.strategy = "scalar";
+        scalar.mode = "-";
+        summaries.push_back(scalar);
+        Summary vectorized = measureBatchProducts(BatchProduct::multiply, options);
+        vectorized.scenario = "batch";
+        vectorized.strategy = BatchProduct::isVectorized() ? "avx2" : "scalar-fallback";
+        vectorized.mode = "-";
+        summaries.push_back(vectorized);
+    }
+    for(auto& scenario : scenarios) {
+        if (options.scenario != "all" && options.scenario != scenario.first)
+            continue;
+        for(Strategy& strategy : strategies) {
+            Summary cold = measureCold(scenario.second, strategy, options, &runtime);
+            cold.scenario = scenario.first;
+            cold.strategy = strategy.name;
+            cold.mode = "cold";
+            summaries.push_back(cold);
+            Summary warm = measureWarm(scenario.second, strategy, options, &runtime);
+            warm.scenario = scenario.first;
+            warm.strategy = strategy.name;
+            warm.mode = "warm";
+            summaries.push_back(warm);
+        }
+        vector<pair<string, Summary (*)(DD* (*)(), const Options&, bool)>> engines = {
+            {"typed", measureImported<TypedDD<ComplexNumber>>},
+            {"store", measureImported<NodeStore>},
+        };
+        for(auto& engine : engines) {
+            for(bool cold : {true, false}) {
+                Summary summary = engine.second(scenario.second, options, cold);
+                summary.scenario = scenario.first;
+                summary.strategy = engine.first;
+                summary.mode = cold ? "cold" : "warm";
+                summaries.push_back(summary);
+            }
+        }
+    }
+    printSummaries(summaries, options, runtime.getNumThreads());
+}
@@ -0,0 +1,2 @@
+g++ -O2 benchmark.cpp -o benchmark -fopenmp -lpthread
+./benchmark "$@"
\ No newline at end of file
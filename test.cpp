@@ -1,11 +1,17 @@
 #include <map>
 #include <omp.h>
+#include <atomic>
+#include <cstdlib>
+#include <climits>
+#include <new>
 #include <cmath>
 #include <chrono>
 #include <thread>
 #include <string>
+#include <sstream>
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 using namespace std;
 
 #include "TDD/Interfaces.cpp"
@@ -15,6 +21,33 @@ using namespace std;
 #include "TDD/Node.cpp"
 #include "TDD/Edge.cpp"
 #include "TDD/DD.cpp"
+#include "TDD/BatchProduct.cpp"
+#include "TDD/TypedDD.cpp"
+#include "TDD/NodeStore.cpp"
+#include "TDD/Snapshot.cpp"
+#include "TDD/MappedDD.cpp"
+#include "DDExamples.cpp"
+
+//  ------------------------- Allocation counter ------------------------ 
+
+std::atomic<long> allocationCount(0);
+
+// Kept out of line: once inlined, GCC sees malloc and free paired with new and delete
+// expressions and reports them as mismatched
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    free(p);
+}
 
 //  ------------------------- Support functions ------------------------- 
 
@@ -22,189 +55,538 @@ void print(string s) {
     cout << s << "\n";
 }
 
-DD* createControlatedDD() {
-    Edge*  leftNode1 = new Edge(1, new Node());
-    Edge* rightNode1 = new Edge(2, new Node());
-    Edge*  leftNode2 = new Edge(1, new Node());
-    Edge* rightNode2 = new Edge(3, new Node());
-    Edge*  leftNode3 = new Edge(1, new Node());
-    Edge* rightNode3 = new Edge(4, new Node());
-    Edge*  leftNode4 = new Edge(1, new Node());
-    Edge* rightNode4 = new Edge(5, new Node());
-    Edge*  leftNode5 = new Edge(1, new Node());
-    Edge* rightNode5 = new Edge(6, new Node());
-    Edge*  leftNode6 = new Edge(1, new Node());
-    Edge* rightNode6 = new Edge(7, new Node());
-    Edge*  leftNode7 = new Edge(1, new Node());
-    Edge* rightNode7 = new Edge(2, new Node());
-    Edge*  leftNode8 = new Edge(1, new Node());
-    Edge* rightNode8 = new Edge(3, new Node());
-
-    Edge*  leftNode1_1 = new Edge(1, new Node(leftNode1, rightNode1));
-    Edge* rightNode1_1 = new Edge(2, new Node(leftNode2, rightNode2));
-    Edge*  leftNode2_1 = new Edge(1, new Node(leftNode3, rightNode3));
-    Edge* rightNode2_1 = new Edge(2, new Node(leftNode4, rightNode4));
-    Edge*  leftNode3_1 = new Edge(1, new Node(leftNode5, rightNode5));
-    Edge* rightNode3_1 = new Edge(2, new Node(leftNode6, rightNode6));
-    Edge*  leftNode4_1 = new Edge(1, new Node(leftNode7, rightNode7));
-    Edge* rightNode4_1 = new Edge(2, new Node(leftNode8, rightNode8));
-    
-    Edge*  leftNode1_2 = new Edge(2, new Node(leftNode1_1, rightNode1_1));
-    Edge* rightNode1_2 = new Edge(10, new Node(leftNode2_1, rightNode2_1));
-    Edge*  leftNode2_2 = new Edge(5, new Node(leftNode3_1, rightNode3_1));
-    Edge* rightNode2_2 = new Edge(2, new Node(leftNode4_1, rightNode4_1));
-
-    Edge*  leftNode1_3 = new Edge(2, new Node(leftNode1_2, rightNode1_2));
-    Edge* rightNode1_3 = new Edge(3, new Node(leftNode2_2, rightNode2_2));
-
-    Edge* head = new Edge(10, new Node(leftNode1_3, rightNode1_3));
-
-    return new DD(head);  // Expected result: 580 608 000
-}
-
-DD* createSmallDD() {
-    Edge*  leftNode1 = new Edge(1, new Node());
-    Edge* rightNode1 = new Edge(2, new Node());
-    Edge*  leftNode2 = new Edge(3, new Node());
-    Edge* rightNode2 = new Edge(4, new Node());
-    Edge*  leftNode3 = new Edge(5, new Node());
-    Edge* rightNode3 = new Edge(6, new Node());
-    Edge*  leftNode4 = new Edge(7, new Node());
-    Edge* rightNode4 = new Edge(8, new Node());
-    Edge*  leftNode5 = new Edge(9, new Node());
-    Edge* rightNode5 = new Edge(10, new Node());
-    Edge*  leftNode6 = new Edge(11, new Node());
-    Edge* rightNode6 = new Edge(12, new Node());
-    Edge*  leftNode7 = new Edge(13, new Node());
-    Edge* rightNode7 = new Edge(14, new Node());
-    Edge*  leftNode8 = new Edge(15, new Node());
-    Edge* rightNode8 = new Edge(16, new Node());
-
-    Edge*  leftNode1_1 = new Edge(17, new Node(leftNode1, rightNode1));
-    Edge* rightNode1_1 = new Edge(18, new Node(leftNode2, rightNode2));
-    Edge*  leftNode2_1 = new Edge(19, new Node(leftNode3, rightNode3));
-    Edge* rightNode2_1 = new Edge(20, new Node(leftNode4, rightNode4));
-    Edge*  leftNode3_1 = new Edge(21, new Node(leftNode5, rightNode5));
-    Edge* rightNode3_1 = new Edge(22, new Node(leftNode6, rightNode6));
-    Edge*  leftNode4_1 = new Edge(23, new Node(leftNode7, rightNode7));
-    Edge* rightNode4_1 = new Edge(24, new Node(leftNode8, rightNode8));
-    
-    Edge*  leftNode1_2 = new Edge(25, new Node(leftNode1_1, rightNode1_1));
-    Edge* rightNode1_2 = new Edge(26, new Node(leftNode2_1, rightNode2_1));
-    Edge*  leftNode2_2 = new Edge(27, new Node(leftNode3_1, rightNode3_1));
-    Edge* rightNode2_2 = new Edge(28, new Node(leftNode4_1, rightNode4_1));
-
-    Edge*  leftNode1_3 = new Edge(29, new Node(leftNode1_2, rightNode1_2));
-    Edge* rightNode1_3 = new Edge(30, new Node(leftNode2_2, rightNode2_2));
-
-    Edge* head = new Edge(31, new Node(leftNode1_3, rightNode1_3));
-
-    return new DD(new Edge(32, new Node(head, head)));
-}
-
-DD* createLargeDD() {
-    int maxLevel = 16;
-    int N = pow(2, maxLevel);
-    Edge *nodeArray[N];
+void printSequentialRuns(DD* dd, int numIters) {
+    print("  # Sequential run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProduct();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
+    }
+}
 
-    for(int i = 0; i < N; i++) {
-        nodeArray[i] = new Edge(new ComplexNumber(i+1, 1), new Node());
+void printParallelRuns(DD* dd, int numIters, int level) {
+    print("  # Parallel run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProductParallel(level);
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     }
+}
 
-    for (int level = 1; level < maxLevel; level++) {
-        N = pow(2, maxLevel - level - 1);
-        for(int i = 0; i < N; i++) {
-            nodeArray[i] = new Edge(
-                new ComplexNumber(level + 1, i), 
-                new Node(nodeArray[2*i], nodeArray[2*i+1])
-            );
-        }
+void printParallelCachedRuns(DD* dd, int numIters, int level) {
+    print("  # Cached parallel run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProductParallelCached(level);
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     }
+}
 
-    Edge*  leftNode1 = new Edge(2, new Node(nodeArray[0], nodeArray[0]));
-    Edge* rightNode1 = new Edge(3, new Node(nodeArray[0], nodeArray[0]));
-    Edge*  leftNode2 = new Edge(2, new Node(nodeArray[0], nodeArray[0]));
-    Edge* rightNode2 = new Edge(5, new Node(nodeArray[1], nodeArray[1]));
-    Edge*  leftNode3 = new Edge(6, new Node(nodeArray[1], nodeArray[0]));
-    Edge* rightNode3 = new Edge(7, new Node(nodeArray[0], nodeArray[1]));
-    Edge*  leftNode4 = new Edge(8, new Node(nodeArray[0], nodeArray[1]));
-    Edge* rightNode4 = new Edge(9, new Node(nodeArray[1], nodeArray[0]));
+void printParallelPrivateRuns(DD* dd, int numIters, int level) {
+    print("  # Private parallel run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProductParallelPrivate(level);
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
+    }
+}
 
-    leftNode1  = new Edge(3, new Node(leftNode1, rightNode1));
-    rightNode1 = new Edge(4, new Node(leftNode2, rightNode2));
-    leftNode2  = new Edge(5, new Node(leftNode3, rightNode3));
-    rightNode2 = new Edge(6, new Node(leftNode4, rightNode4));
+void printAllocations(string name, DD* (*createDD)()) {
+    long before = allocationCount.load();
+    DD* dd = createDD();
+    long built = allocationCount.load();
+    dd->getDDProduct();
+    long multiplied = allocationCount.load();
+    printf("  # %s:\t build allocations: %li\t product allocations: %li\n", name.c_str(), built - before, multiplied - built);
+    delete dd;
+}
 
-    Edge* leftNode = new Edge(10, new Node(leftNode1, rightNode1));
-    Edge* rightNode = new Edge(10, new Node(leftNode2, rightNode2));
+void printParallelAdaptiveRuns(DD* dd, int numIters) {
+    print("  # Adaptive parallel run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProductParallelAdaptive();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
+    }
+}
 
-    return new DD(new Edge(7, new Node(leftNode, rightNode)));
+void printLevelParallelRuns(DD* dd, int numIters) {
+    print("  # Level parallel run:");
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = dd->getDDProductLevelParallel();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
+    }
 }
 
-DD* createEqualDD() {
-    int maxLevel = 19;
-    int N = pow(2, maxLevel);
-    Edge *nodeArray[N];
+void printNormalizedRun(string name, DD* (*createDD)()) {
+    DD* plain = createDD();
+    DD* normalized = createDD();
+    normalized->setNormalized(true);
+    auto start = chrono::high_resolution_clock::now();
+    auto plainResult = plain->getDDProduct();
+    chrono::duration<double, std::milli> plainDuration = chrono::high_resolution_clock::now() - start;
+    start = chrono::high_resolution_clock::now();
+    auto normalizedResult = normalized->getDDProduct();
+    chrono::duration<double, std::milli> normalizedDuration = chrono::high_resolution_clock::now() - start;
+    printf("  # %s:\n", name.c_str());
+    cout << "   --> Plain     \t time: " << plainDuration.count() << "\t nodes: " << plain->getTableStats().unique.entries
+         << "\t result: " << plainResult.canonical().get_string() << "\n";
+    cout << "   --> Normalized\t time: " << normalizedDuration.count() << "\t nodes: " << normalized->getTableStats().unique.entries
+         << "\t result: " << normalizedResult.canonical().get_string() << "\n";
+    // The result diagrams differ in their weights only, so they have the same products
+    bool sameProduct = plain->getProduct().canonical() == normalized->getProduct().canonical();
+    // The next product starts from the result diagrams, which is where the sharing pays
+    start = chrono::high_resolution_clock::now();
+    auto plainNext = plain->getDDProduct();
+    plainDuration = chrono::high_resolution_clock::now() - start;
+    start = chrono::high_resolution_clock::now();
+    auto normalizedNext = normalized->getDDProduct();
+    normalizedDuration = chrono::high_resolution_clock::now() - start;
+    cout << "   --> Next product time, plain: " << plainDuration.count() << "\t normalized: " << normalizedDuration.count() << "\n";
+    cout << "   --> Same getProduct: " << sameProduct
+         << "\t same next product: " << (plainNext.canonical() == normalizedNext.canonical()) << "\n";
+    delete plain;
+    delete normalized;
+}
 
-    for(int i = 0; i < N; i++) {
-        nodeArray[i] = new Edge(100, new Node());
+void printNodeStoreRuns(string name, DD* (*createDD)(), int numIters, bool withProduct) {
+    DD* dd = createDD();
+    NodeStore store(dd->getHeadEdge());
+    printf("  # %s, %zu nodes in %i levels, DD: %zu bytes, store: %zu bytes\n", name.c_str(),
+           store.getNodeCount(), store.getNumLevels(), dd->getArena()->getAllocatedBytes(), store.getMemoryBytes());
+    if (withProduct) {
+        cout << "   --> DD product: " << dd->getProduct().get_string()
+             << "\t store product: " << store.getProduct().get_string() << "\n";
+    }
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = store.getDDProduct();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string()
+             << "\t DD result: " << dd->getDDProduct().get_string() << "\n";
     }
+    delete dd;
+}
 
-    for (int level = 1; level < maxLevel; level++) {
-        N = pow(2, maxLevel - level - 1);
-        for(int i = 0; i < N; i++) {
-            nodeArray[i] = new Edge(
-                (level + 1) * 100, 
-                new Node(nodeArray[2*i], nodeArray[2*i+1])
-            );
-        }
+// A store of a diagram far deeper than the call stack, against the iterative evaluators
+void printDeepNodeStoreRun(string name, DD* dd, int numIters) {
+    auto start = chrono::high_resolution_clock::now();
+    NodeStore store(dd->getHeadEdge());
+    chrono::duration<double, std::milli> importDuration = chrono::high_resolution_clock::now() - start;
+    printf("  # %s, %zu nodes in %i levels, import time: %f\n", name.c_str(), store.getNodeCount(),
+           store.getNumLevels(), importDuration.count());
+    cout << "   --> DD product: " << dd->getProductIterative().get_string()
+         << "\t store product: " << store.getProduct().get_string() << "\n";
+    for(int i = 1; i <= numIters; i++) {
+        cout << "   --> Iter: " << i << "\t result: " << store.getDDProduct().get_string()
+             << "\t DD result: " << dd->getDDProductIterative().get_string() << "\n";
     }
-    Edge* leftNode = new Edge(10, new Node(nodeArray[0], nodeArray[0]));
-    Edge* rightNode = new Edge(5, new Node(nodeArray[0], nodeArray[0]));
+    delete dd;
+}
 
-    return new DD(new Edge(7, new Node(leftNode, rightNode)));
+template<typename Weight>
+void printTypedRuns(string name, DD* dd, int numIters) {
+    TypedDD<Weight> typed(dd->getHeadEdge());
+    printf("  # %s typed run, %zu nodes:\n", name.c_str(), typed.getNodeCount());
+    for(int i = 1; i <= numIters; i++) {
+        auto start = chrono::high_resolution_clock::now();
+        auto res = typed.getDDProduct();
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
+    }
+    delete dd;
 }
 
-void printSequentialRuns(DD* dd, int numIters) {
-    print("  # Sequential run:");
+void printGarbageCollectedRuns(DD* dd, int numIters) {
+    print("  # Garbage collected run:");
     for(int i = 1; i <= numIters; i++) {
         auto start = chrono::high_resolution_clock::now();
         auto res = dd->getDDProduct();
         chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
-        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string()
+             << "\t arena KB: " << dd->getArena()->getAllocatedBytes() / 1024 << "\n";
     }
 }
 
-void printParallelRuns(DD* dd, int numIters, int level) {
-    print("  # Parallel run:");
+// Collects the input of a deep diagram after one product, which frees a dead chain as long
+// as the diagram
+void printChainGarbageCollection(string name, DD* dd) {
+    printf("  # %s, depth %i:\n", name.c_str(), dd->getHeadEdge()->getNode()->getLevel());
+    dd->getDDProductIterative();
+    long before = dd->getTableStats().unique.entries;
+    auto start = chrono::high_resolution_clock::now();
+    std::size_t collected = dd->garbageCollect();
+    chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+    cout << "   --> Time: " << duration.count() << "\t collected: " << collected << "\t nodes before: " << before
+         << "\t after: " << dd->getTableStats().unique.entries << "\n";
+    delete dd;
+}
+
+void printStartupCost(int numThreads) {
+    Runtime runtime(numThreads);
+    DD* dd = createSmallDD();
+    dd->setRuntime(&runtime);
+    int callCounts[] = {1, 10, 100, 1000, 10000};
+    for(int calls : callCounts) {
+        // Previous behaviour: a fixed-size region per call plus the nested region of Node
+        auto start = chrono::high_resolution_clock::now();
+        for(int i = 0; i < calls; i++) {
+            #pragma omp parallel num_threads(numThreads)
+            {
+                #pragma omp single
+                {
+                    #pragma omp parallel num_threads(2)
+                    {
+                        #pragma omp single
+                        dd->getHeadEdge()->getProduct();
+                    }
+                }
+            }
+        }
+        chrono::duration<double, std::micro> perRegion = chrono::high_resolution_clock::now() - start;
+
+        start = chrono::high_resolution_clock::now();
+        for(int i = 0; i < calls; i++) {
+            dd->getProductParallel();
+        }
+        chrono::duration<double, std::micro> pooled = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Calls: " << calls << "\t per call region us: " << perRegion.count() / calls
+             << "\t pooled us: " << pooled.count() / calls << "\n";
+    }
+    delete dd;
+}
+
+void printTableStats(string name, TableStats stats) {
+    printf("   --> %s\t lookups: %li\t hits: %li\t misses: %li\t inserts: %li\t overwrites: %li\t entries: %li\n",
+           name.c_str(), stats.lookups, stats.hits, stats.misses, stats.inserts, stats.overwrites, stats.entries);
+}
+
+void printTableStatsRuns(string name, DD* dd, ComplexNumber (*run)(DD*)) {
+    dd->setTableStatsEnabled(true);
+    run(dd);
+    run(dd);
+    DDTableStats stats = dd->getTableStats();
+    printf("  # %s:\n", name.c_str());
+    printTableStats("Unique table ", stats.unique);
+    printTableStats("Compute table", stats.compute);
+    delete dd;
+}
+
+// The iterative evaluator must leave both tables in the state the recursion leaves them. The
+// two copies get different node ids and so different compute table collisions: all counters
+// only match on diagrams small enough to have no overwrites, the node count always does.
+void printIterativeRuns(string name, DD* (*createDD)(), int numIters, bool withStats) {
+    DD* recursive = createDD();
+    DD* iterative = createDD();
+    recursive->setTableStatsEnabled(true);
+    iterative->setTableStatsEnabled(true);
+    printf("  # %s:\n", name.c_str());
+    cout << "   --> Product\t recursive: " << recursive->getProduct().get_string()
+         << "\t iterative: " << iterative->getProductIterative().get_string() << "\n";
     for(int i = 1; i <= numIters; i++) {
         auto start = chrono::high_resolution_clock::now();
-        auto res = dd->getDDProductParallel(level);
-        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
-        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+        auto recursiveResult = recursive->getDDProduct();
+        chrono::duration<double, std::milli> recursiveDuration = chrono::high_resolution_clock::now() - start;
+        start = chrono::high_resolution_clock::now();
+        auto iterativeResult = iterative->getDDProductIterative();
+        chrono::duration<double, std::milli> iterativeDuration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Iter: " << i << "\t recursive time: " << recursiveDuration.count()
+             << "\t iterative time: " << iterativeDuration.count() << "\t result: " << recursiveResult.get_string()
+             << "\t iterative result: " << iterativeResult.get_string() << "\n";
+    }
+    DDTableStats recursiveStats = recursive->getTableStats();
+    DDTableStats iterativeStats = iterative->getTableStats();
+    if (withStats) {
+        printTableStats("Recursive unique table ", recursiveStats.unique);
+        printTableStats("Iterative unique table ", iterativeStats.unique);
+        printTableStats("Recursive compute table", recursiveStats.compute);
+        printTableStats("Iterative compute table", iterativeStats.compute);
+    } else {
+        cout << "   --> Nodes\t recursive: " << recursiveStats.unique.entries
+             << "\t iterative: " << iterativeStats.unique.entries << "\n";
     }
+    delete recursive;
+    delete iterative;
 }
 
-void printParallelCachedRuns(DD* dd, int numIters, int level) {
-    print("  # Cached parallel run:");
+void printDeepRuns(string name, DD* dd, int numIters) {
+    printf("  # %s, depth %i:\n", name.c_str(), dd->getHeadEdge()->getNode()->getLevel());
+    cout << "   --> Product\t result: " << dd->getProductIterative().get_string() << "\n";
     for(int i = 1; i <= numIters; i++) {
         auto start = chrono::high_resolution_clock::now();
-        auto res = dd->getDDProductParallelCached(level);
+        auto res = dd->getDDProductIterative();
         chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
-        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     }
+    delete dd;
 }
 
-void printParallelPrivateRuns(DD* dd, int numIters, int level) {
-    print("  # Private parallel run:");
-    for(int i = 1; i <= numIters; i++) {
+// Saves a DD after one product, so both tables are warm, and checks the reloaded copy
+// computes the same next products
+void printSnapshotRun(string name, DD* (*createDD)(), bool normalized) {
+    auto start = chrono::high_resolution_clock::now();
+    DD* dd = createDD();
+    chrono::duration<double, std::milli> buildDuration = chrono::high_resolution_clock::now() - start;
+    dd->setNormalized(normalized);
+    dd->getDDProduct();
+    stringstream stream;
+    Snapshot::save(dd, stream);
+    start = chrono::high_resolution_clock::now();
+    DD* loaded = Snapshot::load(stream);
+    chrono::duration<double, std::milli> loadDuration = chrono::high_resolution_clock::now() - start;
+    printf("  # %s%s, %zu bytes:\n", name.c_str(), normalized ? " normalized" : "", stream.str().size());
+    cout << "   --> Build time: " << buildDuration.count() << "\t load time: " << loadDuration.count()
+         << "\t nodes: " << dd->getTableStats().unique.entries << "\t loaded nodes: " << loaded->getTableStats().unique.entries << "\n";
+    cout << "   --> Product\t result: " << dd->getProduct().get_string()
+         << "\t loaded result: " << loaded->getProduct().get_string() << "\n";
+    cout << "   --> DD product\t result: " << dd->getDDProduct().get_string()
+         << "\t loaded result: " << loaded->getDDProduct().get_string() << "\n";
+    delete dd;
+    delete loaded;
+}
+
+// Writes a DD in the mapped format and checks the mapped view evaluates to the same values
+void printMappedRun(string name, DD* (*createDD)()) {
+    DD* dd = createDD();
+    string path = "/tmp/tdd_mapped_" + name + ".tddm";
+    MappedDD::save(dd->getHeadEdge(), path);
+    auto start = chrono::high_resolution_clock::now();
+    MappedDD* mapped = new MappedDD(path);
+    chrono::duration<double, std::milli> openDuration = chrono::high_resolution_clock::now() - start;
+    printf("  # %s, %zu nodes, %zu bytes:\n", name.c_str(), mapped->getNodeCount(), mapped->getFileBytes());
+    start = chrono::high_resolution_clock::now();
+    ComplexNumber product = mapped->getProduct();
+    chrono::duration<double, std::milli> productDuration = chrono::high_resolution_clock::now() - start;
+    cout << "   --> Open time: " << openDuration.count() << "\t product time: " << productDuration.count() << "\n";
+    cout << "   --> Product\t result: " << dd->getProductIterative().get_string()
+         << "\t mapped result: " << product.get_string() << "\n";
+    cout << "   --> DD product\t mapped result: " << mapped->getDDProduct().get_string()
+         << "\t result: " << dd->getDDProductIterative().get_string() << "\n";
+    delete mapped;
+    remove(path.c_str());
+    delete dd;
+}
+
+// Builds the same tree of 2^depth leaves with DDBuilder::tree on runtimes of growing size
+void printBulkBuildRuns(int depth) {
+    printf("  # Tree of 2^%i leaves:\n", depth);
+    int threadCounts[] = {1, 2, 4, 8};
+    for(int threads : threadCounts) {
+        Runtime runtime(threads);
+        DDBuilder builder;
+        builder.setRuntime(&runtime);
         auto start = chrono::high_resolution_clock::now();
-        auto res = dd->getDDProductParallelPrivate(level);
+        DD* dd = builder.tree(depth, [](std::size_t i) {
+            return ComplexNumber(i % 1024 + 1, 1);
+        }, [](int level, std::size_t i) {
+            return ComplexNumber(level + 1, i % 3);
+        });
         chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
-        cout << "   --> Iter: " << i << "\t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+        cout << "   --> Threads: " << threads << "\t time: " << duration.count()
+             << "\t nodes: " << dd->getTableStats().unique.entries << "\t result: " << dd->getProductMemoized().get_string() << "\n";
+        delete dd;
     }
 }
 
+// lanes trees of the same shape with different weights: one NodeStore::getDDProducts pass
+// over all of them against a getDDProduct per tree
+void printValuationRuns(int depth, int lanes) {
+    vector<DD*> dds;
+    vector<NodeStore> stores;
+    for(int k = 0; k < lanes; k++) {
+        DDBuilder builder;
+        dds.push_back(builder.tree(depth, [k](std::size_t i) {
+            return ComplexNumber(i + 1, k + 1);
+        }, [k](int level, std::size_t i) {
+            return ComplexNumber(level + 1, i + k);
+        }));
+        stores.emplace_back(dds[k]->getHeadEdge());
+    }
+    NodeStore::Valuations valuations = stores[0].createValuations(lanes);
+    for(int k = 1; k < lanes; k++) {
+        stores[k].setLane(valuations, k);
+    }
+    // The same weights written straight into the lanes of the first store
+    NodeStore::Valuations direct = stores[0].createValuations(lanes);
+    for(int k = 1; k < lanes; k++) {
+        NodeStore& store = stores[k];
+        stores[0].setLane(direct, k, [&store](uint32_t id, bool right) {
+            return store.getWeight(id, right);
+        }, store.getHeadWeight());
+    }
+    vector<ComplexNumber> directProducts = stores[0].getDDProducts(direct);
+
+    auto start = chrono::high_resolution_clock::now();
+    vector<ComplexNumber> batched = stores[0].getDDProducts(valuations);
+    chrono::duration<double, std::milli> batchedDuration = chrono::high_resolution_clock::now() - start;
+    start = chrono::high_resolution_clock::now();
+    for(NodeStore& store : stores) {
+        store.getDDProduct();
+    }
+    chrono::duration<double, std::milli> separateDuration = chrono::high_resolution_clock::now() - start;
+    int mismatches = 0;
+    int directMismatches = 0;
+    for(int k = 0; k < lanes; k++) {
+        ComplexNumber product = dds[k]->getDDProduct();
+        if (!(batched[k] == product))
+            mismatches++;
+        if (!(directProducts[k] == product))
+            directMismatches++;
+        delete dds[k];
+    }
+    printf("  # Tree of 2^%i leaves, %i weight sets:\n", depth, lanes);
+    cout << "   --> Separate time: " << separateDuration.count() << "\t batched time: " << batchedDuration.count()
+         << "\t mismatches: " << mismatches << "\t direct mismatches: " << directMismatches << "\n";
+}
+
+// Valuations of one diagram handed to the store of a diagram with the same level sizes but
+// other children
+void printValuationRejection() {
+    DDBuilder builder;
+    IEdge* a = builder.node(ComplexNumber(2, 0), builder.leaf(ComplexNumber(3, 0)), builder.leaf(ComplexNumber(5, 0)));
+    IEdge* b = builder.node(ComplexNumber(7, 0), builder.leaf(ComplexNumber(11, 0)), builder.leaf(ComplexNumber(13, 0)));
+    DD* dd = builder.build(builder.node(ComplexNumber(), builder.node(ComplexNumber(), a, b), builder.node(ComplexNumber(), b, a)));
+    a = builder.node(ComplexNumber(2, 0), builder.leaf(ComplexNumber(3, 0)), builder.leaf(ComplexNumber(5, 0)));
+    b = builder.node(ComplexNumber(7, 0), builder.leaf(ComplexNumber(11, 0)), builder.leaf(ComplexNumber(13, 0)));
+    DD* other = builder.build(builder.node(ComplexNumber(), builder.node(ComplexNumber(), a, b), builder.node(ComplexNumber(), a, a)));
+    NodeStore store(dd->getHeadEdge());
+    NodeStore otherStore(other->getHeadEdge());
+    NodeStore::Valuations valuations = store.createValuations(2);
+    try {
+        otherStore.setLane(valuations, 1);
+        cout << "  # Other structure accepted\n";
+    } catch (const std::invalid_argument& error) {
+        cout << "  # Other structure rejected: " << error.what() << "\n";
+    }
+    delete dd;
+    delete other;
+}
+
+// getProduct before and after DD::compactLayout, on the input diagram and on the diagram
+// left by a few products
+void printCompactRuns(string name, DD* (*createDD)(), int numProducts) {
+    DD* dd = createDD();
+    for(int i = 0; i < numProducts; i++) {
+        dd->getDDProductIterative();
+    }
+    auto start = chrono::high_resolution_clock::now();
+    ComplexNumber before = dd->getProductIterative();
+    chrono::duration<double, std::milli> beforeDuration = chrono::high_resolution_clock::now() - start;
+    start = chrono::high_resolution_clock::now();
+    std::size_t nodes = dd->compactLayout();
+    chrono::duration<double, std::milli> compactDuration = chrono::high_resolution_clock::now() - start;
+    start = chrono::high_resolution_clock::now();
+    ComplexNumber after = dd->getProductIterative();
+    chrono::duration<double, std::milli> afterDuration = chrono::high_resolution_clock::now() - start;
+    printf("  # %s after %i products, %zu nodes:\n", name.c_str(), numProducts, nodes);
+    cout << "   --> Compact time: " << compactDuration.count() << "\t product time before: " << beforeDuration.count()
+         << "\t after: " << afterDuration.count() << "\n";
+    cout << "   --> Product\t result: " << before.get_string() << "\t compact result: " << after.get_string() << "\n";
+    cout << "   --> DD product\t compact result: " << dd->getDDProductIterative().get_string() << "\n";
+    delete dd;
+}
+
+void printUniqueTableThroughput(string name, IUniqueTable* (*createTable)()) {
+    // Half of the candidates repeat an earlier key, so lookups mix hits and inserts
+    int N = pow(2, 17);
+    INode* leaf = new Node();
+    vector<INode*> candidates(N);
+    for(int i = 0; i < N; i++) {
+        candidates[i] = new Node(new Edge(i % (N / 2), leaf), new Edge(i % (N / 2), leaf));
+    }
+
+    printf("  # %s:\n", name.c_str());
+    int threadCounts[] = {1, 2, 4, 8, 12, 24};
+    for(int threads : threadCounts) {
+        IUniqueTable* table = createTable();
+        auto start = chrono::high_resolution_clock::now();
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        for(int i = 0; i < N; i++) {
+            table->lookup(candidates[i]);
+        }
+        chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
+        cout << "   --> Threads: " << threads << "\t time: " << duration.count()
+             << "\t lookups/ms: " << N / duration.count() << "\n";
+        delete table;
+    }
+    // The tables leave the nodes to their owner, freeing a node frees its edges
+    for(INode* candidate : candidates) {
+        delete candidate;
+    }
+    delete leaf;
+}
+
+void printReducerMismatches(int numValues) {
+    // Both reducers must agree on every sign and magnitude, products of two residues included
+    constexpr long MOD = ComplexNumber::getModulus();
+    long mismatches = 0;
+    uint64_t state = 1;
+    for(int i = 0; i < numValues; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        long value = (long) state;
+        long x = i % 2 == 0 ? value : (value % MOD) * ((value >> 32) % MOD);
+        if (BarrettReducer<MOD>::reduce(x) != ModuloReducer<MOD>::reduce(x))
+            mismatches++;
+    }
+    long limits[] = {0, 1, -1, MOD - 1, MOD, -MOD, MOD + 1, LONG_MAX, LONG_MIN, LONG_MIN + 1};
+    for(long x : limits) {
+        if (BarrettReducer<MOD>::reduce(x) != ModuloReducer<MOD>::reduce(x))
+            mismatches++;
+    }
+    cout << "   --> Values: " << numValues << "\t mismatches: " << mismatches << "\n";
+}
+
+void printBatchProductMismatches(int numValues) {
+    // Random residues of both signs, the vector path must reproduce the scalar one bit by bit
+    constexpr long MOD = ComplexNumber::getModulus();
+    vector<ComplexNumber> a(numValues), b(numValues), vectorized(numValues), scalar(numValues);
+    uint64_t state = 7;
+    for(int i = 0; i < numValues; i++) {
+        long values[4];
+        for(long& value : values) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            value = (long) (state >> 33) % (2 * MOD - 1) - (MOD - 1);
+        }
+        a[i] = ComplexNumber(values[0], values[1]);
+        b[i] = ComplexNumber(values[2], values[3]);
+    }
+    BatchProduct::multiply(a.data(), b.data(), vectorized.data(), numValues);
+    BatchProduct::multiplyScalar(a.data(), b.data(), scalar.data(), numValues);
+    long mismatches = 0;
+    for(int i = 0; i < numValues; i++) {
+        if (vectorized[i] != scalar[i])
+            mismatches++;
+    }
+    // The pairwise reduction only changes the order of the products, so compare residues
+    ComplexNumber expected = ComplexNumber();
+    for(int i = 0; i < numValues; i++)
+        expected = expected.product(a[i]);
+    ComplexNumber reduced = BatchProduct::reduce(a.data(), numValues);
+    bool sameProduct = (reduced.getRealPart() - expected.getRealPart()) % MOD == 0 &&
+                       (reduced.getImaginaryPart() - expected.getImaginaryPart()) % MOD == 0;
+    cout << "   --> Values: " << numValues << "\t vectorized: " << BatchProduct::isVectorized()
+         << "\t mismatches: " << mismatches << "\t same product: " << sameProduct << "\n";
+}
+
+IUniqueTable* createUniqueTable() {
+    return new UniqueTable();
+}
+
+IUniqueTable* createConcurrentUniqueTable() {
+    return new ConcurrentUniqueTable();
+}
+
+IUniqueTable* createLevelUniqueTable() {
+    return new LevelUniqueTable();
+}
+
 //  --------------------------- Main program ---------------------------- 
 
 int main() {
@@ -229,47 +611,77 @@ int main() {
     auto ut = new UniqueTable();
     ut->insert(node);
     cout << "  # Node lookup table: " << ut->lookup(node)->getString() << "\n";
-    IComplexNumber* c = new ComplexNumber(3, -2);
-    c = c->product(new ComplexNumber(-4, 1));
-    cout << "  # C1 * C2: " << c->get_string() << "\n";                                                     // Expected result: -10 + 11i
+    ComplexNumber c(3, -2);
+    c = c.product(ComplexNumber(-4, 1));
+    cout << "  # C1 * C2: " << c.get_string() << "\n";                                                     // Expected result: -10 + 11i
     print(" Basics tested.\n");
 
+    print(" Testing allocations...");
+    printAllocations("Small DD", createSmallDD);
+    printAllocations("Large DD", createLargeDD);
+    printAllocations("Equal DD", createEqualDD);
+    print(" Allocations tested.\n");
+
+    print(" Testing DD builder...");
+    DDBuilder builder;
+    IEdge* first = builder.node(2, builder.leaf(3), builder.leaf(4));
+    IEdge* second = builder.node(2, builder.leaf(3), builder.leaf(4));
+    printf("  # Equal subdiagrams shared: %s\t nodes: %zu\t edges: %zu\n", first == second ? "yes" : "no",
+           builder.getNodeCount(), builder.getEdgeCount());
+    DD* ddBuilt = builder.build(builder.node(5, first, second));
+    cout << "  # Built DD\t result: " << ddBuilt->getProduct().get_string() << "\n";                      // Expected result: 2880
+    delete ddBuilt;
+    DD* ddEqualBuilt = createEqualDD();
+    printf("  # Equal DD, 2^18 leaves:\t nodes: %li\n", ddEqualBuilt->getTableStats().unique.entries);
+    delete ddEqualBuilt;
+    printBulkBuildRuns(18);
+    print(" DD builder tested.\n");
+
+    print(" Testing unique table throughput...");
+    printUniqueTableThroughput("Single lock table", createUniqueTable);
+    printUniqueTableThroughput("Sharded table", createConcurrentUniqueTable);
+    printUniqueTableThroughput("Per-level table", createLevelUniqueTable);
+    print(" Unique table throughput tested.\n");
+
+
+    print(" Testing parallel start-up cost...");
+    printf("  # Runtime threads: %i\n", Runtime::getDefault()->getNumThreads());
+    printStartupCost(Runtime::getDefault()->getNumThreads());
+    print(" Parallel start-up cost tested.\n");
 
     print(" Testing controlated product...");
-    IComplexNumber* res;
+    ComplexNumber res;
     auto start = chrono::high_resolution_clock::now();
     res = ddControlatedSequential->getProduct();
     chrono::duration<double, std::milli> duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     start = chrono::high_resolution_clock::now();
     res = ddControlatedParallel->getProductParallel();
     duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     print(" Small controlated tested.\n");
 
     print(" Testing small product...");
     start = chrono::high_resolution_clock::now();
     res = ddSmallSequential->getProduct();
     duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     start = chrono::high_resolution_clock::now();
     res = ddSmallParallel->getProductParallel();
     duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res->get_string() << "\n";
+    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res.get_string() << "\n";
     print(" Small product tested.\n");
 
-    /*
     print(" Testing large product...");
     start = chrono::high_resolution_clock::now();
-    res = ddLargeSequential->getProduct();
+    res = ddLargeSequential->getProductMemoized();
     duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res->get_string()  << "\n";
+    cout << "  # Sequential \t time: " << duration.count() << "\t result: " << res.get_string()  << "\n";
     start = chrono::high_resolution_clock::now();
-    res = ddLargeParallel->getProductParallel();
+    res = ddLargeParallel->getProductMemoizedParallel();
     duration = chrono::high_resolution_clock::now() - start;
-    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res->get_string()  << "\n";
+    cout << "  # Parallel \t time: " << duration.count() << "\t result: " << res.get_string()  << "\n";
     print(" Large product tested.\n");
-    */
 
     print(" Testing small DD product...");
     int TIMES = 7;
@@ -292,6 +704,10 @@ int main() {
         printParallelPrivateRuns(ddLargeParallelPrivate, TIMES, level);
         print(" Large DD product tested.\n");
 
+        delete ddLargeSequential;
+        delete ddLargeParallel;
+        delete ddLargeParallelCached;
+        delete ddLargeParallelPrivate;
         ddLargeSequential = createLargeDD();
         ddLargeParallel = createLargeDD();
         ddLargeParallelCached = createLargeDD();
@@ -337,5 +753,127 @@ int main() {
 
     */
 
+    print(" Testing adaptive DD product...");
+    DD* ddSmallAdaptive = createSmallDD();
+    printParallelAdaptiveRuns(ddSmallAdaptive, TIMES);
+    printSequentialRuns(ddLargeSequential, TIMES);
+    DD* ddLargeAdaptive = createLargeDD();
+    printParallelAdaptiveRuns(ddLargeAdaptive, TIMES);
+    delete ddSmallAdaptive;
+    delete ddLargeAdaptive;
+    print(" Adaptive DD product tested.\n");
+
+    print(" Testing table statistics...");
+    printTableStatsRuns("Sequential", createLargeDD(), [](DD* dd) { return dd->getDDProduct(); });
+    printTableStatsRuns("Parallel", createLargeDD(), [](DD* dd) { return dd->getDDProductParallel(2); });
+    printTableStatsRuns("Cached parallel", createLargeDD(), [](DD* dd) { return dd->getDDProductParallelCached(2); });
+    printTableStatsRuns("Private parallel", createLargeDD(), [](DD* dd) { return dd->getDDProductParallelPrivate(2); });
+    print(" Table statistics tested.\n");
+
+    print(" Testing garbage collection...");
+    DD* ddLargeCollected = createLargeDD();
+    ddLargeCollected->setGCThreshold(ddLargeCollected->getArena()->getAllocatedBytes() + 1024 * 1024);
+    printGarbageCollectedRuns(ddLargeCollected, TIMES);
+    delete ddLargeCollected;
+    printChainGarbageCollection("Chain", createChainDD());
+    print(" Garbage collection tested.\n");
+
+    print(" Testing typed DD product...");
+    DD* ddSmallVirtual = createSmallDD();
+    printSequentialRuns(ddSmallVirtual, TIMES);
+    printTypedRuns<ComplexNumber>("Complex", createSmallDD(), TIMES);
+    DD* ddLargeVirtual = createLargeDD();
+    printSequentialRuns(ddLargeVirtual, TIMES);
+    delete ddSmallVirtual;
+    delete ddLargeVirtual;
+    printTypedRuns<ComplexNumber>("Complex", createLargeDD(), TIMES);
+    printTypedRuns<ModularWeight>("Modular", createLargeDD(), TIMES);
+    print(" Typed DD product tested.\n");
+
+    print(" Testing normalized DD product...");
+    printNormalizedRun("Controlated", createControlatedDD);
+    printNormalizedRun("Small", createSmallDD);
+    printNormalizedRun("Large", createLargeDD);
+    printNormalizedRun("Equal", createEqualDD);
+    printNormalizedRun("Scaled", createScaledDD);
+    print(" Normalized DD product tested.\n");
+
+    print(" Testing node store...");
+    printNodeStoreRuns("Controlated", createControlatedDD, TIMES, true);
+    printNodeStoreRuns("Small", createSmallDD, TIMES, true);
+    printNodeStoreRuns("Large", createLargeDD, TIMES, false);
+    printNodeStoreRuns("Equal", createEqualDD, TIMES, false);
+    printDeepNodeStoreRun("Chain", createChainDD(), 2);
+    printValuationRuns(12, 1);
+    printValuationRuns(12, 8);
+    printValuationRuns(16, 8);
+    printValuationRejection();
+    print(" Node store tested.\n");
+
+    print(" Testing iterative DD product...");
+    printIterativeRuns("Controlated", createControlatedDD, 3, true);
+    printIterativeRuns("Small", createSmallDD, 3, true);
+    printIterativeRuns("Large", createLargeDD, 3, false);
+    printIterativeRuns("Equal", createEqualDD, 3, false);
+    printDeepRuns("Chain", createChainDD(), 3);
+    print(" Iterative DD product tested.\n");
+
+    print(" Testing level parallel DD product...");
+    DD* ddSmallLevels = createSmallDD();
+    DD* ddSmallReference = createSmallDD();
+    printSequentialRuns(ddSmallReference, TIMES);
+    printLevelParallelRuns(ddSmallLevels, TIMES);
+    DD* ddEqualLevels = createEqualDD();
+    DD* ddEqualReference = createEqualDD();
+    printSequentialRuns(ddEqualReference, 3);
+    printLevelParallelRuns(ddEqualLevels, 3);
+    delete ddSmallLevels;
+    delete ddSmallReference;
+    delete ddEqualLevels;
+    delete ddEqualReference;
+    print(" Level parallel DD product tested.\n");
+
+    print(" Testing snapshots...");
+    printSnapshotRun("Controlated", createControlatedDD, false);
+    printSnapshotRun("Small", createSmallDD, false);
+    printSnapshotRun("Large", createLargeDD, false);
+    printSnapshotRun("Equal", createEqualDD, false);
+    printSnapshotRun("Scaled", createScaledDD, true);
+    stringstream corrupt("not a snapshot");
+    try {
+        Snapshot::load(corrupt);
+    } catch (std::runtime_error& error) {
+        cout << "  # Corrupt input rejected: " << error.what() << "\n";
+    }
+    print(" Snapshots tested.\n");
+
+    print(" Testing mapped DDs...");
+    printMappedRun("Controlated", createControlatedDD);
+    printMappedRun("Small", createSmallDD);
+    printMappedRun("Large", createLargeDD);
+    printMappedRun("Equal", createEqualDD);
+    printMappedRun("Chain", createChainDD);
+    try {
+        MappedDD missing("/tmp/tdd_mapped_missing.tddm");
+    } catch (std::runtime_error& error) {
+        cout << "  # Missing file rejected: " << error.what() << "\n";
+    }
+    print(" Mapped DDs tested.\n");
+
+    print(" Testing compact layout...");
+    printCompactRuns("Large", createLargeDD, 0);
+    printCompactRuns("Large", createLargeDD, 3);
+    printCompactRuns("Scaled", createScaledDD, 3);
+    printCompactRuns("Chain", createChainDD, 1);
+    print(" Compact layout tested.\n");
+
+    print(" Testing modular reduction...");
+    printReducerMismatches(1000000);
+    print(" Modular reduction tested.\n");
+
+    print(" Testing batched products...");
+    printBatchProductMismatches(1000001);
+    print(" Batched products tested.\n");
+
     print("\n------- Program Ended -------\n");
 }
\ No newline at end of file